@@ -13,8 +13,10 @@
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/Vector3Stamped.h>
 #include <mavros_msgs/Trajectory.h>
+#include <sensor_msgs/PointCloud2.h>
 #include <tf/transform_listener.h>
 #include <mutex>
+#include <vector>
 
 namespace avoidance {
 
@@ -259,6 +261,38 @@ PolarPoint cartesianToPolarFCU(const pcl::PointXYZ& p);
 **/
 
 Eigen::Vector2i polarToHistogramIndex(const PolarPoint& p_pol, int res);
+
+/**
+* @brief     approximation of atan2 evaluated on whole arrays at once, such
+*            that Eigen can vectorize it
+* @param[in] y, numerator coordinates
+* @param[in] x, denominator coordinates
+* @returns   angles in rad [-PI, PI], the absolute error is below 1e-6 rad
+* @note      uses the polynomial approximation of Abramowitz & Stegun 4.4.49
+**/
+Eigen::ArrayXf atan2Approximation(const Eigen::ArrayXf& y, const Eigen::ArrayXf& x);
+
+/**
+* @brief     batched version of cartesianToPolarHistogram followed by
+*            polarToHistogramIndex, working on a structure of arrays
+* @param[in] x, y, z cartesian coordinates of the points, equal length
+* @param[in] origin, position from which to compute the polar coordinates
+* @param[in] res, resolution of the histogram in degrees
+* @param[out]e_index, elevation histogram index of each point
+* @param[out]z_index, azimuth histogram index of each point
+* @param[out]radius, distance of each point to the origin
+* @note      Points lying within 1e-4 degrees of a bin edge can end up in the
+*            neighboring bin compared to the scalar functions. Non-finite
+*            points get a valid index but a non-finite radius.
+**/
+void cartesianToHistogramIndex(const Eigen::ArrayXf& x, const Eigen::ArrayXf& y, const Eigen::ArrayXf& z,
+                               const Eigen::Vector3f& origin, int res, Eigen::ArrayXi& e_index,
+                               Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius);
+void cartesianToHistogramIndex(const pcl::PointCloud<pcl::PointXYZ>& cloud, const Eigen::Vector3f& origin, int res,
+                               Eigen::ArrayXi& e_index, Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius);
+void cartesianToHistogramIndex(const pcl::PointCloud<pcl::PointXYZI>& cloud, const Eigen::Vector3f& origin, int res,
+                               Eigen::ArrayXi& e_index, Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius);
+
 /**
 * @brief     support function for polarToHistogramIndex
 *            when abs(elevation) > 90, wrap elevation angle into valid
@@ -369,6 +403,73 @@ pcl::PointCloud<pcl::PointXYZ> removeNaNAndGetMaxima(pcl::PointCloud<pcl::PointX
 **/
 void updateFOVFromMaxima(FOV& fov, const pcl::PointCloud<pcl::PointXYZ>& maxima);
 
+/**
+* @brief           Reads the XYZ fields of a PointCloud2 message directly from
+*                  its data buffer and in the same pass removes NAN values,
+*                  tracks the outermost points for the FOV, applies a rigid
+*                  transform and crops points out of range
+* @param[in]       msg, point cloud message with FLOAT32 x, y and z fields
+* @param[in]       transform, rigid transform from the sensor frame to the
+*                  target frame
+* @param[in]       max_range, points further away from the sensor are dropped
+*                  [m]
+* @param[out]      cloud, transformed points. Only the points are written, its
+*                  storage is reused between calls
+* @param[out]      maxima, outermost points in the sensor frame, as returned by
+*                  removeNaNAndGetMaxima (cropped points are included)
+* @returns         false if the message layout is not supported, in which case
+*                  cloud and maxima are empty
+**/
+bool transformPointCloud2AndGetMaxima(const sensor_msgs::PointCloud2& msg, const Eigen::Affine3f& transform,
+                                      float max_range, pcl::PointCloud<pcl::PointXYZ>& cloud,
+                                      pcl::PointCloud<pcl::PointXYZ>& maxima);
+
+/**
+* @brief           Same as transformPointCloud2AndGetMaxima with a single
+*                  transform, but compensates the motion of the sensor while
+*                  the scan is captured: the rows are split into equally sized
+*                  slices in capture order and every slice is transformed with
+*                  the transform at its capture time
+* @param[in]       msg, point cloud message with FLOAT32 x, y and z fields
+* @param[in]       slice_transforms, transforms from the sensor frame to the
+*                  target frame, one per slice, see getSliceTransforms
+* @param[in]       max_range, points further away from the sensor are dropped
+*                  [m]
+* @param[out]      cloud, transformed points
+* @param[out]      maxima, outermost points in the sensor frame
+* @returns         false if the message layout is not supported or no
+*                  transform is given
+**/
+bool transformPointCloud2AndGetMaxima(const sensor_msgs::PointCloud2& msg,
+                                      const std::vector<tf::StampedTransform>& slice_transforms, float max_range,
+                                      pcl::PointCloud<pcl::PointXYZ>& cloud, pcl::PointCloud<pcl::PointXYZ>& maxima);
+
+/**
+* @brief           Looks up the transforms at the capture times of the slices
+*                  of a scan whose rows are captured evenly over scan_duration,
+*                  with the stamp at the center of the scan. A single slice is
+*                  looked up at the stamp
+* @param[in]       stamp, capture time of the center of the scan
+* @param[in]       scan_duration, time between capturing the first and the
+*                  last row
+* @param[in]       num_slices, number of slices the rows are split into
+* @param[in]       lookup, callable bool(const ros::Time&, tf::StampedTransform&)
+*                  retrieving the transform at a time, e.g. from a TransformBuffer
+* @param[out]      slice_transforms, transform of every slice, first row first
+* @returns         true if the transforms of all slices could be retrieved
+**/
+template <typename LookupFunction>
+bool getSliceTransforms(const ros::Time& stamp, const ros::Duration& scan_duration, size_t num_slices,
+                        LookupFunction lookup, std::vector<tf::StampedTransform>& slice_transforms) {
+  slice_transforms.resize(num_slices);
+  for (size_t i = 0; i < num_slices; ++i) {
+    // center of the slice relative to the center of the scan, in [-0.5, 0.5]
+    const double offset = (i + 0.5) / num_slices - 0.5;
+    if (!lookup(stamp + ros::Duration(offset * scan_duration.toSec()), slice_transforms[i])) return false;
+  }
+  return true;
+}
+
 inline Eigen::Vector3f toEigen(const geometry_msgs::Point& p) {
   Eigen::Vector3f ev3(p.x, p.y, p.z);
   return ev3;
@@ -398,6 +499,15 @@ inline Eigen::Quaternionf toEigen(const geometry_msgs::Quaternion& gmq) {
   return eqf;
 }
 
+inline Eigen::Affine3f toEigen(const tf::Transform& t) {
+  const tf::Quaternion& q = t.getRotation();
+  const tf::Vector3& o = t.getOrigin();
+  Eigen::Affine3f ea3 = Eigen::Affine3f::Identity();
+  ea3.linear() = Eigen::Quaternionf(q.w(), q.x(), q.y(), q.z()).toRotationMatrix();
+  ea3.translation() = Eigen::Vector3f(o.x(), o.y(), o.z());
+  return ea3;
+}
+
 inline geometry_msgs::Point toPoint(const Eigen::Vector3f& ev3) {
   geometry_msgs::Point gmp;
   gmp.x = ev3.x();
@@ -0,0 +1,126 @@
+#pragma once
+
+#include "avoidance/transform_buffer.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace avoidance {
+
+namespace tf_buffer {
+
+/**
+* @brief      transform buffer for one writer and many concurrent readers.
+*             Every frame pair stores its transforms in a fixed capacity ring
+*             guarded by a seqlock: readers never take a lock, they copy the
+*             bracketing transforms and retry if a write overlapped. Writers
+*             only serialize against other writers of the same frame pair
+**/
+class ConcurrentTransformBuffer {
+ public:
+  /**
+  * @param[in]  buffer_size_s, transforms older than this relative to the
+  *             newest one are dropped [s]
+  * @param[in]  capacity, maximum number of transforms per frame pair, the
+  *             oldest ones are overwritten when the ring is full
+  * @param[in]  max_frame_pairs, maximum number of frame pairs
+  **/
+  ConcurrentTransformBuffer(float buffer_size_s = 10.0f, size_t capacity = 2048, size_t max_frame_pairs = 64);
+  ~ConcurrentTransformBuffer() = default;
+
+  ConcurrentTransformBuffer(const ConcurrentTransformBuffer&) = delete;
+  ConcurrentTransformBuffer& operator=(const ConcurrentTransformBuffer&) = delete;
+
+  /**
+  * @brief      resolves the handle of a frame pair, registering the pair if it
+  *             is not known yet. Handles stay valid for the buffer lifetime
+  * @param[in]  source_frame
+  * @param[in]  target_frame
+  * @returns    handle of the frame pair, an invalid handle which fails all
+  *             lookups if max_frame_pairs is exceeded
+  **/
+  FramePairHandle getFramePairHandle(const std::string& source_frame, const std::string& target_frame);
+
+  /**
+  * @brief      inserts transform into buffer
+  * @param[in]  frame_pair, handle of the source and target frame
+  * @param[in]  transform
+  * @returns    bool, true if transform was inserted (will not be inserted
+  *             if it is the same or older than the last one that was buffered)
+  * @note       a transform stamped at time zero, as tf returns for a chain of
+  *             static transforms, is static: it replaces the buffered ones and
+  *             is returned for any time until a stamped transform is inserted
+  **/
+  bool insertTransform(FramePairHandle frame_pair, const tf::StampedTransform& transform);
+
+  /**
+  * @brief      retrieves transform from buffer without blocking
+  * @param[in]  frame_pair, handle of the source and target frame
+  * @param[in]  time, timestamp of the requested transform
+  * @param[out] transform
+  * @returns    bool, true if the transform could be retrieved from the buffer
+  **/
+  bool getTransform(FramePairHandle frame_pair, const ros::Time& time, tf::StampedTransform& transform) const;
+
+  /**
+  * @brief      string wrappers of the handle API. The frame pair is resolved
+  *             under a mutex, use handles on hot paths
+  **/
+  bool insertTransform(const std::string& source_frame, const std::string& target_frame,
+                       const tf::StampedTransform& transform);
+  bool getTransform(const std::string& source_frame, const std::string& target_frame, const ros::Time& time,
+                    tf::StampedTransform& transform) const;
+
+ private:
+  // transform stored as individual atomics so readers racing with the writer stay well defined
+  struct Entry {
+    std::atomic<uint64_t> stamp_ns{0};
+    std::array<std::atomic<double>, 7> pose{};  ///< translation x, y, z and rotation x, y, z, w
+  };
+
+  struct Ring {
+    explicit Ring(size_t capacity) : entries(new Entry[capacity]) {}
+
+    std::mutex writer_mutex;
+    std::atomic<uint64_t> sequence{0};   ///< odd while a write is in progress
+    std::atomic<uint64_t> begin{0};      ///< insertion count of the oldest buffered transform
+    std::atomic<uint64_t> end{0};        ///< insertion count after the newest buffered transform
+    std::atomic<bool> is_static{false};  ///< the newest transform is static and valid at any time
+    std::unique_ptr<Entry[]> entries;
+  };
+
+  // copy of a transform taken by a reader
+  struct Sample {
+    uint64_t stamp_ns = 0;
+    std::array<double, 7> pose{};
+  };
+
+  enum class Lookup { found, empty, not_arrived, dropped };
+
+  const uint64_t buffer_size_ns_;
+  const size_t capacity_;
+
+  mutable std::mutex registry_mutex_;
+  std::unordered_map<std::string, FramePairHandle> frame_pairs_;
+  std::vector<std::unique_ptr<Ring>> rings_;  ///< fixed size, slots below num_frame_pairs_ are immutable
+  std::atomic<size_t> num_frame_pairs_{0};
+
+  ros::Time startup_time_;
+
+  /**
+  * @brief      searches the transforms bracketing the requested time, the
+  *             result is only valid if the ring sequence did not change
+  **/
+  Lookup find(const Ring& ring, uint64_t time_ns, Sample& earlier, Sample& later) const;
+
+  void read(const Entry& entry, Sample& sample) const;
+  const Ring* ring(FramePairHandle frame_pair) const;
+};
+}
+}
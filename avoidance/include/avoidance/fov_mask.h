@@ -0,0 +1,93 @@
+#ifndef AVOIDANCE_FOV_MASK_H
+#define AVOIDANCE_FOV_MASK_H
+
+#include "avoidance/common.h"
+
+#include <Eigen/Core>
+
+#include <cstdint>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     field of view precomputed over a polar histogram grid around the
+*            vehicle, so the FOV test of a point binned into the grid is a
+*            single lookup. Every cell is classified as inside, outside or on
+*            the border of the FOV, only points in border cells are tested
+*            against the FOV structs. The mask is built with a margin of the
+*            attitude tolerance and only rebuilt when the FOV changes or the
+*            vehicle yaw or pitch moved further than that, the result is the
+*            same as pointInsideFOV for any attitude
+**/
+class FOVMask {
+ public:
+  enum class Cell : uint8_t { outside, inside, border };
+
+  /**
+  * @param[in] attitude_tolerance_deg, yaw and pitch change the mask stays
+  *            valid for [deg]
+  **/
+  explicit FOVMask(float attitude_tolerance_deg = 0.5f);
+  ~FOVMask() = default;
+
+  /**
+  * @brief     rebuilds the mask if any of the inputs changed meaningfully
+  * @param[in] fov, field of view of all cameras in the fcu frame
+  * @param[in] yaw_fcu_frame_deg, vehicle yaw in the fcu frame
+  * @param[in] pitch_fcu_frame_deg, vehicle pitch in the fcu frame
+  * @param[in] res, angular resolution of the histogram grid [deg]
+  * @returns   true if the mask was rebuilt
+  **/
+  bool update(const std::vector<FOV>& fov, float yaw_fcu_frame_deg, float pitch_fcu_frame_deg, int res);
+
+  /**
+  * @brief     classification of a histogram cell
+  * @param[in] e, elevation index as computed by cartesianToHistogramIndex
+  * @param[in] z, azimuth index as computed by cartesianToHistogramIndex
+  **/
+  Cell cell(int e, int z) const { return mask_[e * z_dim_ + z]; }
+
+  /**
+  * @brief     cells inside or on the border of the FOV, as e * (360 / res) + z
+  **/
+  const std::vector<int>& coveredCells() const { return covered_; }
+
+  /**
+  * @brief     determines whether a point is inside the FOV, same result as
+  *            pointInsideFOV of its polar coordinates in the fcu frame
+  *            corrected by the vehicle attitude
+  * @param[in] e, elevation index of the point relative to position
+  * @param[in] z, azimuth index of the point relative to position
+  * @param[in] point, only used if the cell is on the FOV border
+  * @param[in] position, current vehicle position
+  * @returns   whether the point is inside the FOV
+  **/
+  bool pointInsideFOV(int e, int z, const Eigen::Vector3f& point, const Eigen::Vector3f& position) const;
+
+ private:
+  // angular bounds in the fcu frame, inclusive [deg]
+  struct Rectangle {
+    float z_min, z_max, e_min, e_max;
+  };
+
+  const float attitude_tolerance_deg_;
+
+  int res_ = 0;
+  int z_dim_ = 0;
+  std::vector<Cell> mask_;
+  std::vector<int> covered_;
+
+  // inputs the mask was built for, the attitude is the one of the last update
+  std::vector<FOV> fov_;
+  float built_yaw_deg_ = 0.f;
+  float built_pitch_deg_ = 0.f;
+  float yaw_deg_ = 0.f;
+  float pitch_deg_ = 0.f;
+
+  void build();
+  static Cell classify(const Rectangle& piece, const std::vector<Rectangle>& fov_rectangles);
+};
+}
+
+#endif  // AVOIDANCE_FOV_MASK_H
@@ -4,6 +4,7 @@
 #include <float.h>
 #include <math.h>
 #include <Eigen/Dense>
+#include <stdexcept>
 #include <vector>
 
 namespace avoidance {
@@ -11,31 +12,36 @@ namespace avoidance {
 // Be very careful choosing the resolution! Valid resolutions must fullfill:
 // 180 % (2 * ALPHA_RES) = 0
 // Examples of valid resolution values: 1, 3, 5, 6, 10, 15, 18, 30, 45, 60
-const int ALPHA_RES = 6;
-const int GRID_LENGTH_Z = 360 / ALPHA_RES;
-const int GRID_LENGTH_E = 180 / ALPHA_RES;
+constexpr int ALPHA_RES = 6;
+constexpr int GRID_LENGTH_Z = 360 / ALPHA_RES;
+constexpr int GRID_LENGTH_E = 180 / ALPHA_RES;
 
-class Histogram {
-  int resolution_;
-  int z_dim_;
-  int e_dim_;
-  Eigen::MatrixXf dist_;
+/**
+* @brief     polar histogram with a bin size of RES degrees. The grid
+*            dimensions are known at compile time, so the distance layer lives
+*            in fixed-size aligned storage and no histogram operation allocates
+**/
+template <int RES>
+class PolarHistogram {
+  static_assert(RES > 0 && 180 % RES == 0, "Histogram resolution must divide 180 degrees");
+
+ public:
+  static constexpr int E_DIM = 180 / RES;
+  static constexpr int Z_DIM = 360 / RES;
+
+  PolarHistogram() { setZero(); }
 
   /**
-  * @brief     wraps elevation and azimuth indeces around the histogram
-  * @param     x, elevation angle index
-  * @param     y, azimuth angle index
+  * @brief     constructs an empty histogram after checking that the requested
+  *            resolution matches the compile time resolution
+  * @param[in] res, bin size [deg]
   **/
-  inline void wrapIndex(int &x, int &y) const {
-    x = x % e_dim_;
-    if (x < 0) x += e_dim_;
-    y = y % z_dim_;
-    if (y < 0) y += z_dim_;
+  explicit PolarHistogram(const int res) : PolarHistogram() {
+    if (res != RES) {
+      throw std::logic_error("Invalid histogram resolution. The resolution is fixed at compile time.");
+    }
   }
-
- public:
-  Histogram(const int res);
-  ~Histogram() = default;
+  ~PolarHistogram() = default;
 
   /**
   * @brief     getter method for histogram cell distance
@@ -43,10 +49,7 @@ class Histogram {
   * @param[in] y, azimuth angle index
   * @returns   distance to the vehicle of obstacle mapped to (x, y) cell [m]
   **/
-  inline float get_dist(int x, int y) const {
-    wrapIndex(x, y);
-    return dist_(x, y);
-  }
+  inline float get_dist(int x, int y) const { return dist_(wrapIndex(x, E_DIM), wrapIndex(y, Z_DIM)); }
 
   /**
   * @brief     setter method for histogram cell distance
@@ -57,44 +60,82 @@ class Histogram {
   **/
   inline void set_dist(int x, int y, float value) { dist_(x, y) = value; }
 
+  /**
+  * @brief     getter method for the whole distance layer
+  * @returns   obstacle distances, rows are elevation and columns azimuth
+  *            angle indices [m]
+  **/
+  const Eigen::Matrix<float, E_DIM, Z_DIM>& distances() const { return dist_; }
+
   /**
   * @brief     Compute the upsampled version of the histogram
-  * @param[in] This object. Needs to be a histogram the larger bin size
-  *(ALPHA_RES * 2)
-  * @details   The histogram is upsampled to get the same histogram at regular
-  *bin size (ALPHA_RES).
-  *            This means the histogram matrix will be double the size in each
-  *dimension
-  * @returns   Modifies the object it is called from to have regular resolution
-  * @warning   Can only be called from a large bin size histogram
+  * @details   The histogram is upsampled to get the same histogram at half the
+  *            bin size. Every cell is split into four cells of equal distance
+  * @returns   histogram with bin size RES / 2
   **/
-  void upsample();
+  PolarHistogram<RES / 2> upsample() const {
+    static_assert(RES % 2 == 0, "Only histograms with an even bin size can be upsampled");
+    PolarHistogram<RES / 2> upsampled;
+    for (int i = 0; i < PolarHistogram<RES / 2>::E_DIM; ++i) {
+      for (int j = 0; j < PolarHistogram<RES / 2>::Z_DIM; ++j) {
+        upsampled.set_dist(i, j, dist_(i / 2, j / 2));
+      }
+    }
+    return upsampled;
+  }
 
   /**
   * @brief     Compute the downsampled version of the histogram
-  * @param[in] this object. Needs to be a histogram with regular bin size
-  *(ALPHA_RES)
-  * @details   The histogram is downsampled to get the same histogram at larger
-  *bin size (ALPHA_RES/2).
-  *            This means the histogram matrix will be half the size in each
-  *dimension
-  * @returns   Modifies the object it is called from to have larger bins
-  * @warning   Can only be called from a regular bin size histogram
+  * @details   The histogram is downsampled to get the same histogram at double
+  *            the bin size. Four cells are fused into one by taking their mean
+  * @returns   histogram with bin size RES * 2
   **/
-  void downsample();
+  PolarHistogram<RES * 2> downsample() const {
+    static_assert(E_DIM % 2 == 0 && Z_DIM % 2 == 0, "Downsampling needs an even number of cells");
+    PolarHistogram<RES * 2> downsampled;
+    for (int i = 0; i < PolarHistogram<RES * 2>::E_DIM; ++i) {
+      for (int j = 0; j < PolarHistogram<RES * 2>::Z_DIM; ++j) {
+        downsampled.set_dist(i, j, dist_.template block<2, 2>(2 * i, 2 * j).mean());
+      }
+    }
+    return downsampled;
+  }
 
   /**
   * @brief     resets all histogram cells age and distance to zero
   **/
-  void setZero();
+  void setZero() { dist_.setZero(); }
 
   /**
   * @brief     determines whether the histogram is empty (distance layer
   *            contains no distance bigger than zero)
   * @returns   whether histogram is empty
   **/
-  bool isEmpty() const;
+  bool isEmpty() const { return !(dist_.array() > FLT_MIN).any(); }
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+ private:
+  Eigen::Matrix<float, E_DIM, Z_DIM> dist_;
+
+  /**
+  * @brief     wraps an index around the histogram without branching
+  * @param[in] i, elevation or azimuth angle index
+  * @param[in] dim, number of cells in the wrapped dimension
+  * @returns   index in [0, dim)
+  **/
+  static inline int wrapIndex(int i, int dim) {
+    const int wrapped = i % dim;
+    return wrapped + (dim & -static_cast<int>(wrapped < 0));
+  }
 };
+
+template <int RES>
+constexpr int PolarHistogram<RES>::E_DIM;
+template <int RES>
+constexpr int PolarHistogram<RES>::Z_DIM;
+
+typedef PolarHistogram<ALPHA_RES> Histogram;
 }
 
 #endif  // HISTOGRAM_H
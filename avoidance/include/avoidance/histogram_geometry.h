@@ -0,0 +1,73 @@
+#ifndef AVOIDANCE_HISTOGRAM_GEOMETRY_H
+#define AVOIDANCE_HISTOGRAM_GEOMETRY_H
+
+#include "avoidance/histogram.h"
+
+#include <Eigen/Core>
+
+namespace avoidance {
+
+/**
+* @brief     bin geometry of the ALPHA_RES histogram grid. The angles, their
+*            sines and cosines and the unit direction of every bin center are
+*            computed once, so code iterating over histogram bins does not
+*            need any trigonometry
+**/
+class HistogramGeometry {
+ public:
+  typedef Eigen::Array<float, GRID_LENGTH_E, 1> ElevationArray;
+  typedef Eigen::Array<float, GRID_LENGTH_Z, 1> AzimuthArray;
+
+  /**
+  * @brief     getter method for the shared table, built on first use
+  **/
+  static const HistogramGeometry& get();
+
+  /**
+  * @brief     bin center angles
+  * @param[in] e, elevation angle index
+  * @param[in] z, azimuth angle index
+  * @returns   angle in the histogram frame [deg]
+  **/
+  float elevation(int e) const { return elevation_(e); }
+  float azimuth(int z) const { return azimuth_(z); }
+
+  /**
+  * @brief     sines and cosines of the bin center angles, one entry per
+  *            elevation or azimuth index
+  **/
+  const ElevationArray& cosElevation() const { return cos_elevation_; }
+  const ElevationArray& sinElevation() const { return sin_elevation_; }
+  const AzimuthArray& cosAzimuth() const { return cos_azimuth_; }
+  const AzimuthArray& sinAzimuth() const { return sin_azimuth_; }
+
+  /**
+  * @brief     azimuthal width of the bins at an elevation, relative to the
+  *            bins at zero elevation
+  * @param[in] e, elevation angle index
+  **/
+  float binWidth(int e) const { return cos_elevation_(e); }
+
+  /**
+  * @brief     unit vector pointing to the center of a bin
+  * @param[in] e, elevation angle index
+  * @param[in] z, azimuth angle index
+  * @returns   direction in cartesian coordinates, same convention as
+  *            polarHistogramToCartesian
+  **/
+  Eigen::Vector3f direction(int e, int z) const { return directions_.col(e * GRID_LENGTH_Z + z); }
+
+ private:
+  ElevationArray elevation_;
+  ElevationArray cos_elevation_;
+  ElevationArray sin_elevation_;
+  AzimuthArray azimuth_;
+  AzimuthArray cos_azimuth_;
+  AzimuthArray sin_azimuth_;
+  Eigen::Matrix<float, 3, GRID_LENGTH_E * GRID_LENGTH_Z> directions_;
+
+  HistogramGeometry();
+};
+}
+
+#endif  // AVOIDANCE_HISTOGRAM_GEOMETRY_H
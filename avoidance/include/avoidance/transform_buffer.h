@@ -7,6 +7,7 @@
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace avoidance {
 
@@ -14,11 +15,66 @@ namespace tf_buffer {
 
 enum log_level { error, warn, info, debug };
 
+/**
+* @brief      interned source/target frame pair. Resolve it once with
+*             getFramePairHandle, lookups through the handle neither build nor
+*             hash the frame names
+**/
+typedef size_t FramePairHandle;
+
+/**
+* @brief      interpolates between transforms
+* @param[in]  tf_earlier
+* @param[in]  tf_later
+* @param[in/out] transform, [in]  empty transform stamped with DESIRED TIMESTAMP
+*                           [out] correctly interpolated tf if interpolation is possible
+*                                 otherwise transform remains unchanged
+* @returns    bool, true if the transform was correctly interpolated
+**/
+bool interpolateTransform(const tf::StampedTransform& tf_earlier, const tf::StampedTransform& tf_later,
+                          tf::StampedTransform& transform);
+
+/**
+* @brief      prints a message, nothing is printed in the first seconds after
+*             the startup of a buffer while the transforms are still arriving
+* @param[in]  startup_time, time the buffer was created
+* @param[in]  level, valid options are: error, warn, info, debug
+* @param[in]  msg, string that should be printed
+**/
+void print(const ros::Time& startup_time, const log_level& level, const std::string& msg);
+
 class TransformBuffer {
  public:
   TransformBuffer(float buffer_size_s = 10.0f);
   virtual ~TransformBuffer() = default;
 
+  /**
+  * @brief      resolves the handle of a frame pair, registering the pair if it
+  *             is not known yet. Handles stay valid for the buffer lifetime
+  * @param[in]  source_frame
+  * @param[in]  target_frame
+  * @returns    handle of the frame pair
+  **/
+  FramePairHandle getFramePairHandle(const std::string& source_frame, const std::string& target_frame);
+
+  /**
+  * @brief      inserts transform into buffer
+  * @param[in]  frame_pair, handle of the source and target frame
+  * @param[in]  transform
+  * @returns    bool, true if transform was inserted (will not be inserted
+  *             if it is the same or older than the last one that was buffered)
+  **/
+  bool insertTransform(FramePairHandle frame_pair, const tf::StampedTransform& transform);
+
+  /**
+  * @brief      retrieves transform from buffer
+  * @param[in]  frame_pair, handle of the source and target frame
+  * @param[in]  time, timestamp of the requested transform
+  * @param[out] transform
+  * @returns    bool, true if the transform could be retrieved from the buffer
+  **/
+  bool getTransform(FramePairHandle frame_pair, const ros::Time& time, tf::StampedTransform& transform) const;
+
   /**
   * @brief      inserts transform into buffer
   * @param[in]  source_frame
@@ -42,7 +98,8 @@ class TransformBuffer {
                     tf::StampedTransform& transform) const;
 
  protected:
-  std::unordered_map<std::string, std::deque<tf::StampedTransform>> buffer_;
+  std::unordered_map<std::string, FramePairHandle> frame_pairs_;
+  std::vector<std::deque<tf::StampedTransform>> buffer_;  ///< time ordered transforms, indexed by frame pair handle
   mutable std::mutex mutex_;
   ros::Duration buffer_size_;
   ros::Time startup_time_;
@@ -56,23 +113,16 @@ class TransformBuffer {
   std::string getKey(const std::string& source_frame, const std::string& target_frame) const;
 
   /**
-  * @brief      interpolates between transforms
-  * @param[in]  tf_earlier
-  * @param[in]  tf_later
-  * @param[in/out] transform, [in]  empty transform stamped with DESIRED TIMESTAMP
-  *                           [out] correctly interpolated tf if interpolation is possible
-  *                                 otherwise transform remains unchanged
-  * @returns    bool, true if the transform was correctly interpolated
+  * @brief      retrieves transform from the buffer of a frame pair, the mutex
+  *             has to be held by the caller
+  * @param[in]  transforms, time ordered transforms of the frame pair
+  * @param[in]  time, timestamp of the requested transform
+  * @param[out] transform
+  * @returns    bool, true if the transform could be retrieved from the buffer
   **/
-  bool interpolateTransform(const tf::StampedTransform& tf_earlier, const tf::StampedTransform& tf_later,
-                            tf::StampedTransform& transform) const;
+  bool lookupTransform(const std::deque<tf::StampedTransform>& transforms, const ros::Time& time,
+                       tf::StampedTransform& transform) const;
 
-  /**
-  * @brief      prints a message
-  * @param[in]  level, valid options are: error, warn, info, debug
-  * @param[in]  msg, string that should be printed
-  **/
-  void print(const log_level& level, const std::string& msg) const;
 };
 }
 }
@@ -1,11 +1,176 @@
 #include "avoidance/common.h"
+#include "avoidance/histogram_geometry.h"
 
+#include <cfloat>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <limits>
 #include <vector>
 
+namespace {
+// number of points converted at once by the batched histogram index functions,
+// small enough such that all temporaries stay in the L1 cache
+const int BATCH_BLOCK_SIZE = 64;
+typedef Eigen::Array<float, BATCH_BLOCK_SIZE, 1> BlockArrayf;
+typedef Eigen::Array<int, BATCH_BLOCK_SIZE, 1> BlockArrayi;
+
+template <typename ArrayT>
+ArrayT atan2Polynomial(const ArrayT& y, const ArrayT& x) {
+  const ArrayT abs_x = x.abs();
+  const ArrayT abs_y = y.abs();
+  // reduce to atan(a) with a in [0, 1], guard the division for the origin
+  const ArrayT a = abs_x.min(abs_y) / abs_x.max(abs_y).max(FLT_MIN);
+  const ArrayT s = a * a;
+
+  // odd polynomial of A&S 4.4.49 evaluated with Horner's scheme
+  const float coeffs[8] = {-0.3333314528f, 0.1999355085f, -0.1420889944f, 0.1065626393f,
+                           -0.0752896400f, 0.0429096138f, -0.0161657367f, 0.0028662257f};
+  ArrayT poly = ArrayT::Constant(a.size(), coeffs[7]);
+  for (int i = 6; i >= 0; --i) {
+    poly = poly * s + coeffs[i];
+  }
+  ArrayT angle = a + a * s * poly;
+
+  // map back to the full circle
+  angle = (abs_y > abs_x).select(0.5f * M_PI_F - angle, angle);
+  angle = (x < 0.f).select(M_PI_F - angle, angle);
+  angle = (y < 0.f).select(-angle, angle);
+  return angle;
+}
+
+void histogramIndexBlock(const BlockArrayf& x, const BlockArrayf& y, const BlockArrayf& z,
+                         const Eigen::Vector3f& origin, int res, BlockArrayi& e_index, BlockArrayi& z_index,
+                         BlockArrayf& radius) {
+  const BlockArrayf dx = x - origin.x();
+  const BlockArrayf dy = y - origin.y();
+  const BlockArrayf dz = z - origin.z();
+  const BlockArrayf den = (dx.square() + dy.square()).sqrt();
+  radius = (den.square() + dz.square()).sqrt();
+
+  // same convention as cartesianToPolarHistogram, angles are directly scaled to bins
+  const float rad_to_bin = 180.f / (M_PI_F * res);
+  BlockArrayf e_bin = (atan2Polynomial(dz, den) * rad_to_bin + 90.f / res).floor();
+  BlockArrayf z_bin = (atan2Polynomial(dx, dy) * rad_to_bin + 180.f / res).floor();
+
+  // NAN input would otherwise end up as an undefined integer
+  e_bin = e_bin.isFinite().select(e_bin, 0.f);
+  z_bin = z_bin.isFinite().select(z_bin, 0.f);
+
+  // an azimuth of exactly 180 deg wraps to -180 deg, elevation is clamped
+  const int z_dim = 360 / res;
+  const int e_dim = 180 / res;
+  z_index = z_bin.cast<int>();
+  z_index = (z_index >= z_dim).select(z_index - z_dim, z_index).max(0);
+  e_index = e_bin.cast<int>().max(0).min(e_dim - 1);
+}
+
+// converts n points, accessed through load(i, x, y, z), block by block
+template <typename LoadFunction>
+void blockwiseHistogramIndex(size_t n, LoadFunction load, const Eigen::Vector3f& origin, int res,
+                             Eigen::ArrayXi& e_index, Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius) {
+  e_index.resize(n);
+  z_index.resize(n);
+  radius.resize(n);
+
+  BlockArrayf x, y, z, block_radius;
+  BlockArrayi block_e_index, block_z_index;
+  for (size_t start = 0; start < n; start += BATCH_BLOCK_SIZE) {
+    const int length = static_cast<int>(std::min<size_t>(BATCH_BLOCK_SIZE, n - start));
+    if (length < BATCH_BLOCK_SIZE) {
+      x.setZero();
+      y.setZero();
+      z.setZero();
+    }
+    for (int i = 0; i < length; ++i) {
+      load(start + i, x[i], y[i], z[i]);
+    }
+
+    histogramIndexBlock(x, y, z, origin, res, block_e_index, block_z_index, block_radius);
+    e_index.segment(start, length) = block_e_index.head(length);
+    z_index.segment(start, length) = block_z_index.head(length);
+    radius.segment(start, length) = block_radius.head(length);
+  }
+}
+
+// the rows of the message are split into num_slices equally sized slices, each transformed with its own transform.
+// The transform only changes between rows, so the per point work is the same as for a single transform
+bool transformSlicesAndGetMaxima(const sensor_msgs::PointCloud2& msg, const Eigen::Affine3f* slice_transforms,
+                                 size_t num_slices, float max_range, pcl::PointCloud<pcl::PointXYZ>& cloud,
+                                 pcl::PointCloud<pcl::PointXYZ>& maxima) {
+  cloud.points.clear();
+  maxima.points.clear();
+  maxima.header.frame_id = msg.header.frame_id;
+
+  // locate the coordinates in the point layout
+  int offset[3] = {-1, -1, -1};
+  const char* axis_names[3] = {"x", "y", "z"};
+  for (const auto& field : msg.fields) {
+    for (int k = 0; k < 3; ++k) {
+      if (field.name == axis_names[k] && field.datatype == sensor_msgs::PointField::FLOAT32) {
+        offset[k] = static_cast<int>(field.offset);
+      }
+    }
+  }
+  const size_t num_points = static_cast<size_t>(msg.width) * msg.height;
+  if (offset[0] < 0 || offset[1] < 0 || offset[2] < 0 || msg.point_step < 3 * sizeof(float) ||
+      msg.row_step < msg.width * msg.point_step ||
+      msg.data.size() < static_cast<size_t>(msg.row_step) * msg.height) {
+    return false;
+  }
+
+  const float max_range_sq = max_range * max_range;
+  cloud.points.reserve(num_points);
+
+  // same layout as removeNaNAndGetMaxima: x_max, y_max, z_max, x_min, y_min, z_min
+  float extreme_value[6] = {-9999.f, -9999.f, -9999.f, 9999.f, 9999.f, 9999.f};
+  pcl::PointXYZ extreme_point[6];
+  bool found_valid_point = false;
+
+  for (uint32_t row = 0; row < msg.height; ++row) {
+    const Eigen::Affine3f& transform = slice_transforms[static_cast<size_t>(row) * num_slices / msg.height];
+    const Eigen::Matrix3f rotation = transform.linear();
+    const Eigen::Vector3f translation = transform.translation();
+    const uint8_t* point_data = msg.data.data() + static_cast<size_t>(row) * msg.row_step;
+    for (uint32_t col = 0; col < msg.width; ++col, point_data += msg.point_step) {
+      Eigen::Vector3f p;
+      std::memcpy(&p.x(), point_data + offset[0], sizeof(float));
+      std::memcpy(&p.y(), point_data + offset[1], sizeof(float));
+      std::memcpy(&p.z(), point_data + offset[2], sizeof(float));
+      if (!std::isfinite(p.x()) || !std::isfinite(p.y()) || !std::isfinite(p.z())) continue;
+      found_valid_point = true;
+
+      for (int k = 0; k < 3; ++k) {
+        if (p[k] > extreme_value[k]) {
+          extreme_value[k] = p[k];
+          extreme_point[k] = pcl::PointXYZ(p.x(), p.y(), p.z());
+        }
+        if (p[k] < extreme_value[k + 3]) {
+          extreme_value[k + 3] = p[k];
+          extreme_point[k + 3] = pcl::PointXYZ(p.x(), p.y(), p.z());
+        }
+      }
+
+      if (p.squaredNorm() > max_range_sq) continue;
+      const Eigen::Vector3f p_transformed = rotation * p + translation;
+      cloud.points.push_back(pcl::PointXYZ(p_transformed.x(), p_transformed.y(), p_transformed.z()));
+    }
+  }
+
+  cloud.height = 1;
+  cloud.width = static_cast<uint32_t>(cloud.points.size());
+  cloud.is_dense = true;
+
+  if (found_valid_point) {
+    for (int k = 0; k < 6; ++k) {
+      maxima.push_back(extreme_point[k]);
+    }
+  }
+  return true;
+}
+}
+
 namespace avoidance {
 
 bool pointInsideFOV(const std::vector<FOV>& fov_vec, const PolarPoint& p_pol) {
@@ -25,10 +190,10 @@ bool pointInsideFOV(const FOV& fov, const PolarPoint& p_pol) {
 
 bool histogramIndexYawInsideFOV(const std::vector<FOV>& fov_vec, const int idx, Eigen::Vector3f position,
                                 float yaw_fcu_frame) {
-  PolarPoint pol_hist = histogramIndexToPolar(GRID_LENGTH_E / 2, idx, ALPHA_RES, 1.f);
-  Eigen::Vector3f cart = polarHistogramToCartesian(pol_hist, position);
-  PolarPoint pol_fcu = cartesianToPolarFCU(cart, position);  // z down convention
-  pol_fcu.z -= yaw_fcu_frame;                                // transform to fcu body frame
+  // same conversion as cartesianToPolarFCU of the bin direction, taken from the bin center angles
+  const HistogramGeometry& geometry = HistogramGeometry::get();
+  PolarPoint pol_fcu(-geometry.elevation(GRID_LENGTH_E / 2), 90.f - geometry.azimuth(idx), 1.f);  // z down convention
+  pol_fcu.z -= yaw_fcu_frame;  // transform to fcu body frame
   PolarPoint pol_fcu_plus = pol_fcu;
   PolarPoint pol_fcu_minus = pol_fcu;
   pol_fcu_plus.z += ALPHA_RES / 2.f;
@@ -40,10 +205,10 @@ bool histogramIndexYawInsideFOV(const std::vector<FOV>& fov_vec, const int idx,
 }
 
 bool histogramIndexYawInsideFOV(const FOV& fov, const int idx, Eigen::Vector3f position, float yaw_fcu_frame) {
-  PolarPoint pol_hist = histogramIndexToPolar(GRID_LENGTH_E / 2, idx, ALPHA_RES, 1.f);
-  Eigen::Vector3f cart = polarHistogramToCartesian(pol_hist, position);
-  PolarPoint pol_fcu = cartesianToPolarFCU(cart, position);  // z down convention
-  pol_fcu.z -= yaw_fcu_frame;                                // transform to fcu body frame
+  // same conversion as cartesianToPolarFCU of the bin direction, taken from the bin center angles
+  const HistogramGeometry& geometry = HistogramGeometry::get();
+  PolarPoint pol_fcu(-geometry.elevation(GRID_LENGTH_E / 2), 90.f - geometry.azimuth(idx), 1.f);  // z down convention
+  pol_fcu.z -= yaw_fcu_frame;  // transform to fcu body frame
   PolarPoint pol_fcu_plus = pol_fcu;
   PolarPoint pol_fcu_minus = pol_fcu;
   pol_fcu_plus.z += ALPHA_RES / 2.f;
@@ -194,6 +359,41 @@ Eigen::Vector2i polarToHistogramIndex(const PolarPoint& p_pol, int res) {
   return ev2;
 }
 
+Eigen::ArrayXf atan2Approximation(const Eigen::ArrayXf& y, const Eigen::ArrayXf& x) {
+  return atan2Polynomial<Eigen::ArrayXf>(y, x);
+}
+
+void cartesianToHistogramIndex(const Eigen::ArrayXf& x, const Eigen::ArrayXf& y, const Eigen::ArrayXf& z,
+                               const Eigen::Vector3f& origin, int res, Eigen::ArrayXi& e_index,
+                               Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius) {
+  auto load = [&](size_t i, float& p_x, float& p_y, float& p_z) {
+    p_x = x[i];
+    p_y = y[i];
+    p_z = z[i];
+  };
+  blockwiseHistogramIndex(x.size(), load, origin, res, e_index, z_index, radius);
+}
+
+void cartesianToHistogramIndex(const pcl::PointCloud<pcl::PointXYZ>& cloud, const Eigen::Vector3f& origin, int res,
+                               Eigen::ArrayXi& e_index, Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius) {
+  auto load = [&](size_t i, float& p_x, float& p_y, float& p_z) {
+    p_x = cloud.points[i].x;
+    p_y = cloud.points[i].y;
+    p_z = cloud.points[i].z;
+  };
+  blockwiseHistogramIndex(cloud.points.size(), load, origin, res, e_index, z_index, radius);
+}
+
+void cartesianToHistogramIndex(const pcl::PointCloud<pcl::PointXYZI>& cloud, const Eigen::Vector3f& origin, int res,
+                               Eigen::ArrayXi& e_index, Eigen::ArrayXi& z_index, Eigen::ArrayXf& radius) {
+  auto load = [&](size_t i, float& p_x, float& p_y, float& p_z) {
+    p_x = cloud.points[i].x;
+    p_y = cloud.points[i].y;
+    p_z = cloud.points[i].z;
+  };
+  blockwiseHistogramIndex(cloud.points.size(), load, origin, res, e_index, z_index, radius);
+}
+
 void wrapPolar(PolarPoint& p_pol) {
   // first wrap the angles to +-180 degrees
   p_pol.e = wrapAngleToPlusMinus180(p_pol.e);
@@ -402,6 +602,28 @@ pcl::PointCloud<pcl::PointXYZ> removeNaNAndGetMaxima(pcl::PointCloud<pcl::PointX
   return maxima;
 }
 
+bool transformPointCloud2AndGetMaxima(const sensor_msgs::PointCloud2& msg, const Eigen::Affine3f& transform,
+                                      float max_range, pcl::PointCloud<pcl::PointXYZ>& cloud,
+                                      pcl::PointCloud<pcl::PointXYZ>& maxima) {
+  return transformSlicesAndGetMaxima(msg, &transform, 1, max_range, cloud, maxima);
+}
+
+bool transformPointCloud2AndGetMaxima(const sensor_msgs::PointCloud2& msg,
+                                      const std::vector<tf::StampedTransform>& slice_transforms, float max_range,
+                                      pcl::PointCloud<pcl::PointXYZ>& cloud, pcl::PointCloud<pcl::PointXYZ>& maxima) {
+  if (slice_transforms.empty()) {
+    cloud.points.clear();
+    maxima.points.clear();
+    return false;
+  }
+  std::vector<Eigen::Affine3f, Eigen::aligned_allocator<Eigen::Affine3f>> transforms;
+  transforms.reserve(slice_transforms.size());
+  for (const tf::StampedTransform& transform : slice_transforms) {
+    transforms.push_back(toEigen(transform));
+  }
+  return transformSlicesAndGetMaxima(msg, transforms.data(), transforms.size(), max_range, cloud, maxima);
+}
+
 void updateFOVFromMaxima(FOV& fov, const pcl::PointCloud<pcl::PointXYZ>& maxima) {
   float h_min = 9999.f, h_max = -9999.f, v_min = 9999.f, v_max = -9999.f;
 
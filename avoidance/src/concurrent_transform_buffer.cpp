@@ -0,0 +1,246 @@
+#include "avoidance/concurrent_transform_buffer.h"
+
+#include <thread>
+
+namespace avoidance {
+
+namespace tf_buffer {
+
+ConcurrentTransformBuffer::ConcurrentTransformBuffer(float buffer_size_s, size_t capacity, size_t max_frame_pairs)
+    : buffer_size_ns_(ros::Duration(buffer_size_s).toNSec()),
+      capacity_(capacity > 1 ? capacity : 2),
+      rings_(max_frame_pairs) {
+  startup_time_ = ros::Time::now();
+}
+
+FramePairHandle ConcurrentTransformBuffer::getFramePairHandle(const std::string& source_frame,
+                                                              const std::string& target_frame) {
+  std::lock_guard<std::mutex> lck(registry_mutex_);
+  const std::string key = source_frame + "_to_" + target_frame;
+  auto iterator = frame_pairs_.find(key);
+  if (iterator != frame_pairs_.end()) {
+    return iterator->second;
+  }
+
+  const size_t num_frame_pairs = num_frame_pairs_.load(std::memory_order_relaxed);
+  if (num_frame_pairs == rings_.size()) {
+    ROS_ERROR("TF Buffer: could not register %s, too many frame pairs", key.c_str());
+    return rings_.size();
+  }
+  // the ring is complete before the count publishes it to the readers
+  rings_[num_frame_pairs].reset(new Ring(capacity_));
+  frame_pairs_[key] = num_frame_pairs;
+  num_frame_pairs_.store(num_frame_pairs + 1, std::memory_order_release);
+  return num_frame_pairs;
+}
+
+const ConcurrentTransformBuffer::Ring* ConcurrentTransformBuffer::ring(FramePairHandle frame_pair) const {
+  if (frame_pair >= num_frame_pairs_.load(std::memory_order_acquire)) {
+    return nullptr;
+  }
+  return rings_[frame_pair].get();
+}
+
+bool ConcurrentTransformBuffer::insertTransform(FramePairHandle frame_pair, const tf::StampedTransform& transform) {
+  if (frame_pair >= num_frame_pairs_.load(std::memory_order_acquire)) {
+    ROS_ERROR("TF Buffer: could not insert transform into buffer, unregistered");
+    return false;
+  }
+
+  Ring* ring = rings_[frame_pair].get();
+  std::lock_guard<std::mutex> lck(ring->writer_mutex);
+  const uint64_t stamp_ns = transform.stamp_.toNSec();
+  uint64_t begin = ring->begin.load(std::memory_order_relaxed);
+  uint64_t end = ring->end.load(std::memory_order_relaxed);
+
+  const bool was_static = ring->is_static.load(std::memory_order_relaxed);
+  const tf::Vector3& origin = transform.getOrigin();
+  const tf::Quaternion rotation = transform.getRotation();
+  const std::array<double, 7> pose = {
+      {origin.x(), origin.y(), origin.z(), rotation.x(), rotation.y(), rotation.z(), rotation.w()}};
+
+  if (stamp_ns == 0) {
+    // a static transform is only stored again if it changed
+    if (was_static) {
+      Sample current;
+      read(ring->entries[(end - 1) % capacity_], current);
+      if (current.pose == pose) {
+        return false;
+      }
+    }
+  } else if (!was_static && end > begin &&
+             ring->entries[(end - 1) % capacity_].stamp_ns.load(std::memory_order_relaxed) >= stamp_ns) {
+    // check if the given transform is newer than the last buffered one
+    return false;
+  }
+
+  const uint64_t sequence = ring->sequence.load(std::memory_order_relaxed);
+  ring->sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  // a static transform replaces the content of the ring, so does the first stamped one after it
+  if (stamp_ns == 0 || was_static) {
+    begin = end;
+  }
+  ring->is_static.store(stamp_ns == 0, std::memory_order_relaxed);
+
+  Entry& entry = ring->entries[end % capacity_];
+  entry.stamp_ns.store(stamp_ns, std::memory_order_relaxed);
+  for (size_t i = 0; i < pose.size(); ++i) {
+    entry.pose[i].store(pose[i], std::memory_order_relaxed);
+  }
+
+  // the oldest transform is overwritten once the ring is full, others are removed once outside the buffer size
+  end++;
+  if (end - begin > capacity_) {
+    begin = end - capacity_;
+  }
+  while (begin + 1 < end &&
+         stamp_ns - ring->entries[begin % capacity_].stamp_ns.load(std::memory_order_relaxed) > buffer_size_ns_) {
+    begin++;
+  }
+  ring->begin.store(begin, std::memory_order_relaxed);
+  ring->end.store(end, std::memory_order_relaxed);
+
+  ring->sequence.store(sequence + 2, std::memory_order_release);
+  return true;
+}
+
+void ConcurrentTransformBuffer::read(const Entry& entry, Sample& sample) const {
+  sample.stamp_ns = entry.stamp_ns.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < sample.pose.size(); ++i) {
+    sample.pose[i] = entry.pose[i].load(std::memory_order_relaxed);
+  }
+}
+
+ConcurrentTransformBuffer::Lookup ConcurrentTransformBuffer::find(const Ring& ring, uint64_t time_ns, Sample& earlier,
+                                                                  Sample& later) const {
+  const uint64_t begin = ring.begin.load(std::memory_order_relaxed);
+  const uint64_t end = ring.end.load(std::memory_order_relaxed);
+  // an inconsistent range can only be seen while a write overlaps, the sequence check rejects the result
+  if (end <= begin || end - begin > capacity_) {
+    return Lookup::empty;
+  }
+
+  // a static transform is valid at any time
+  if (ring.is_static.load(std::memory_order_relaxed)) {
+    read(ring.entries[(end - 1) % capacity_], later);
+    earlier = later;
+    return Lookup::found;
+  }
+
+  auto stamp = [&](uint64_t index) { return ring.entries[index % capacity_].stamp_ns.load(std::memory_order_relaxed); };
+  if (stamp(end - 1) < time_ns) {
+    return Lookup::not_arrived;
+  } else if (stamp(begin) > time_ns) {
+    return Lookup::dropped;
+  }
+
+  // first transform after the requested time. A request for the newest stamp is interpolated between the last two
+  uint64_t low = begin;
+  uint64_t high = end;
+  while (low < high) {
+    uint64_t middle = low + (high - low) / 2;
+    if (stamp(middle) <= time_ns) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  uint64_t later_index = low < end ? low : end - 1;
+  uint64_t earlier_index = later_index > begin ? later_index - 1 : later_index;
+
+  read(ring.entries[earlier_index % capacity_], earlier);
+  read(ring.entries[later_index % capacity_], later);
+  return Lookup::found;
+}
+
+bool ConcurrentTransformBuffer::getTransform(FramePairHandle frame_pair, const ros::Time& time,
+                                             tf::StampedTransform& transform) const {
+  const Ring* ring = this->ring(frame_pair);
+  if (ring == nullptr) {
+    print(startup_time_, log_level::error,
+          "TF Buffer: could not retrieve requested transform from buffer, unregistered");
+    return false;
+  }
+
+  // seqlock read: retry until no write overlapped with copying the bracketing transforms
+  const uint64_t time_ns = time.toNSec();
+  Sample earlier, later;
+  Lookup result;
+  while (true) {
+    const uint64_t sequence = ring->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+      std::this_thread::yield();
+      continue;
+    }
+    result = find(*ring, time_ns, earlier, later);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (ring->sequence.load(std::memory_order_relaxed) == sequence) {
+      break;
+    }
+  }
+
+  switch (result) {
+    case Lookup::empty: {
+      print(startup_time_, log_level::warn,
+            "TF Buffer: could not retrieve requested transform from buffer, buffer is empty");
+      return false;
+    }
+    case Lookup::not_arrived: {
+      print(startup_time_, log_level::debug,
+            "TF Buffer: could not retrieve requested transform from buffer, tf has not yet arrived");
+      return false;
+    }
+    case Lookup::dropped: {
+      print(startup_time_, log_level::warn,
+            "TF Buffer: could not retrieve requested transform from buffer, tf has already been dropped from buffer");
+      return false;
+    }
+    case Lookup::found:
+      break;
+  }
+
+  auto toTransform = [](const Sample& sample) {
+    tf::StampedTransform stamped;
+    stamped.setOrigin(tf::Vector3(sample.pose[0], sample.pose[1], sample.pose[2]));
+    stamped.setRotation(tf::Quaternion(sample.pose[3], sample.pose[4], sample.pose[5], sample.pose[6]));
+    stamped.stamp_.fromNSec(sample.stamp_ns);
+    return stamped;
+  };
+  tf::StampedTransform tf_earlier = toTransform(earlier);
+  tf::StampedTransform tf_later = toTransform(later);
+  if (earlier.stamp_ns == later.stamp_ns) {
+    // only a single transform, stamped exactly at the requested time or static
+    transform = tf_later;
+    transform.stamp_ = time;
+    return true;
+  }
+
+  transform.stamp_ = time;
+  if (interpolateTransform(tf_earlier, tf_later, transform)) {
+    return true;
+  }
+  print(startup_time_, log_level::warn, "TF Buffer: could not interpolate transform");
+  return false;
+}
+
+bool ConcurrentTransformBuffer::insertTransform(const std::string& source_frame, const std::string& target_frame,
+                                                const tf::StampedTransform& transform) {
+  return insertTransform(getFramePairHandle(source_frame, target_frame), transform);
+}
+
+bool ConcurrentTransformBuffer::getTransform(const std::string& source_frame, const std::string& target_frame,
+                                             const ros::Time& time, tf::StampedTransform& transform) const {
+  FramePairHandle frame_pair = rings_.size();
+  {
+    std::lock_guard<std::mutex> lck(registry_mutex_);
+    auto iterator = frame_pairs_.find(source_frame + "_to_" + target_frame);
+    if (iterator != frame_pairs_.end()) {
+      frame_pair = iterator->second;
+    }
+  }
+  return getTransform(frame_pair, time, transform);
+}
+}
+}
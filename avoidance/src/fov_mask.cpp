@@ -0,0 +1,140 @@
+#include "avoidance/fov_mask.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace avoidance {
+
+namespace {
+// covers the rounding of the binned angles against the exactly computed ones
+const float ANGLE_EPSILON_DEG = 0.01f;
+
+bool sameFOV(const std::vector<FOV>& a, const std::vector<FOV>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].yaw_deg != b[i].yaw_deg || a[i].pitch_deg != b[i].pitch_deg || a[i].h_fov_deg != b[i].h_fov_deg ||
+        a[i].v_fov_deg != b[i].v_fov_deg) {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+FOVMask::Cell FOVMask::classify(const Rectangle& piece, const std::vector<Rectangle>& fov_rectangles) {
+  bool outside_all = true;
+  for (const Rectangle& fov : fov_rectangles) {
+    if (fov.z_min <= piece.z_min && piece.z_max <= fov.z_max && fov.e_min <= piece.e_min && piece.e_max <= fov.e_max) {
+      return Cell::inside;
+    }
+    if (!(piece.z_max < fov.z_min || piece.z_min > fov.z_max || piece.e_max < fov.e_min || piece.e_min > fov.e_max)) {
+      outside_all = false;
+    }
+  }
+  return outside_all ? Cell::outside : Cell::border;
+}
+
+FOVMask::FOVMask(float attitude_tolerance_deg) : attitude_tolerance_deg_(attitude_tolerance_deg) {}
+
+bool FOVMask::update(const std::vector<FOV>& fov, float yaw_fcu_frame_deg, float pitch_fcu_frame_deg, int res) {
+  yaw_deg_ = yaw_fcu_frame_deg;
+  pitch_deg_ = pitch_fcu_frame_deg;
+  if (res == res_ && sameFOV(fov, fov_) &&
+      std::abs(angleDifference(yaw_fcu_frame_deg, built_yaw_deg_)) <= attitude_tolerance_deg_ &&
+      std::abs(pitch_fcu_frame_deg - built_pitch_deg_) <= attitude_tolerance_deg_) {
+    return false;
+  }
+
+  res_ = res;
+  fov_ = fov;
+  built_yaw_deg_ = yaw_fcu_frame_deg;
+  built_pitch_deg_ = pitch_fcu_frame_deg;
+  build();
+  return true;
+}
+
+void FOVMask::build() {
+  const int e_dim = 180 / res_;
+  z_dim_ = 360 / res_;
+  mask_.assign(e_dim * z_dim_, Cell::outside);
+  covered_.clear();
+
+  // same bounds as pointInsideFOV
+  std::vector<Rectangle> fov_rectangles;
+  for (const FOV& fov : fov_) {
+    fov_rectangles.push_back({wrapAngleToPlusMinus180(fov.yaw_deg - fov.h_fov_deg / 2.f),
+                              wrapAngleToPlusMinus180(fov.yaw_deg + fov.h_fov_deg / 2.f),
+                              fov.pitch_deg - fov.v_fov_deg / 2.f, fov.pitch_deg + fov.v_fov_deg / 2.f});
+  }
+
+  // the cells are widened by the attitude tolerance, so the classification holds for any attitude within it
+  const float margin = attitude_tolerance_deg_ + ANGLE_EPSILON_DEG;
+  for (int e = 0; e < e_dim; ++e) {
+    // same transformation to the fcu frame as cartesianToPolarFCU, corrected by the vehicle pitch
+    const float e_min = -static_cast<float>((e + 1) * res_ - 90) - built_pitch_deg_ - margin;
+    const float e_max = -static_cast<float>(e * res_ - 90) - built_pitch_deg_ + margin;
+
+    for (int z = 0; z < z_dim_; ++z) {
+      float z_min = -static_cast<float>((z + 1) * res_ - 180) + 90.f - built_yaw_deg_ - margin;
+      float z_max = -static_cast<float>(z * res_ - 180) + 90.f - built_yaw_deg_ + margin;
+      const float wrap_offset = wrapAngleToPlusMinus180(0.5f * (z_min + z_max)) - 0.5f * (z_min + z_max);
+      z_min += wrap_offset;
+      z_max += wrap_offset;
+
+      // split the cell where wrapPolar makes the coordinates of its points discontinuous
+      Rectangle pieces[2];
+      int num_pieces = 1;
+      if (e_max > 90.f) {
+        // folded over the pole, the azimuth of the points is no longer bounded
+        pieces[0] = {-180.f, 180.f, std::min(e_min, 180.f - e_max), 90.f};
+      } else if (e_min < -90.f) {
+        pieces[0] = {-180.f, 180.f, -90.f, std::max(e_max, -180.f - e_min)};
+      } else if (z_min <= -180.f) {
+        pieces[0] = {z_min + 360.f, 180.f, e_min, e_max};
+        pieces[1] = {-180.f, z_max, e_min, e_max};
+        num_pieces = 2;
+      } else if (z_max >= 180.f) {
+        pieces[0] = {z_min, 180.f, e_min, e_max};
+        pieces[1] = {-180.f, z_max - 360.f, e_min, e_max};
+        num_pieces = 2;
+      } else {
+        pieces[0] = {z_min, z_max, e_min, e_max};
+      }
+
+      int num_inside = 0, num_outside = 0;
+      for (int i = 0; i < num_pieces; ++i) {
+        const Cell piece = classify(pieces[i], fov_rectangles);
+        num_inside += piece == Cell::inside;
+        num_outside += piece == Cell::outside;
+      }
+      Cell& cell = mask_[e * z_dim_ + z];
+      if (num_inside == num_pieces) {
+        cell = Cell::inside;
+      } else if (num_outside == num_pieces) {
+        cell = Cell::outside;
+      } else {
+        cell = Cell::border;
+      }
+      if (cell != Cell::outside) {
+        covered_.push_back(e * z_dim_ + z);
+      }
+    }
+  }
+}
+
+bool FOVMask::pointInsideFOV(int e, int z, const Eigen::Vector3f& point, const Eigen::Vector3f& position) const {
+  switch (cell(e, z)) {
+    case Cell::inside:
+      return true;
+    case Cell::outside:
+      return false;
+    case Cell::border:
+      break;
+  }
+  PolarPoint p_pol_fcu = cartesianToPolarFCU(point, position);
+  p_pol_fcu.e -= pitch_deg_;
+  p_pol_fcu.z -= yaw_deg_;
+  wrapPolar(p_pol_fcu);
+  return avoidance::pointInsideFOV(fov_, p_pol_fcu);
+}
+}
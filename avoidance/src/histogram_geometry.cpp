@@ -0,0 +1,33 @@
+#include "avoidance/histogram_geometry.h"
+#include "avoidance/common.h"
+
+#include <cmath>
+
+namespace avoidance {
+
+HistogramGeometry::HistogramGeometry() {
+  for (int e = 0; e < GRID_LENGTH_E; e++) {
+    elevation_(e) = histogramIndexToPolar(e, 0, ALPHA_RES, 1.f).e;
+    cos_elevation_(e) = std::cos(elevation_(e) * DEG_TO_RAD);
+    sin_elevation_(e) = std::sin(elevation_(e) * DEG_TO_RAD);
+  }
+
+  for (int z = 0; z < GRID_LENGTH_Z; z++) {
+    azimuth_(z) = histogramIndexToPolar(0, z, ALPHA_RES, 1.f).z;
+    cos_azimuth_(z) = std::cos(azimuth_(z) * DEG_TO_RAD);
+    sin_azimuth_(z) = std::sin(azimuth_(z) * DEG_TO_RAD);
+  }
+
+  for (int e = 0; e < GRID_LENGTH_E; e++) {
+    for (int z = 0; z < GRID_LENGTH_Z; z++) {
+      directions_.col(e * GRID_LENGTH_Z + z) = Eigen::Vector3f(
+          cos_elevation_(e) * sin_azimuth_(z), cos_elevation_(e) * cos_azimuth_(z), sin_elevation_(e));
+    }
+  }
+}
+
+const HistogramGeometry& HistogramGeometry::get() {
+  static const HistogramGeometry geometry;
+  return geometry;
+}
+}
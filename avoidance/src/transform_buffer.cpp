@@ -1,5 +1,7 @@
 #include "avoidance/transform_buffer.h"
 
+#include <algorithm>
+
 namespace avoidance {
 
 namespace tf_buffer {
@@ -12,8 +14,8 @@ std::string TransformBuffer::getKey(const std::string& source_frame, const std::
   return source_frame + "_to_" + target_frame;
 }
 
-bool TransformBuffer::interpolateTransform(const tf::StampedTransform& tf_earlier, const tf::StampedTransform& tf_later,
-                                           tf::StampedTransform& transform) const {
+bool interpolateTransform(const tf::StampedTransform& tf_earlier, const tf::StampedTransform& tf_later,
+                          tf::StampedTransform& transform) {
   // check if the requested timestamp lies between the two given transforms
   if (transform.stamp_ > tf_later.stamp_ || transform.stamp_ < tf_earlier.stamp_) {
     return false;
@@ -31,72 +33,106 @@ bool TransformBuffer::interpolateTransform(const tf::StampedTransform& tf_earlie
   return true;
 }
 
-bool TransformBuffer::insertTransform(const std::string& source_frame, const std::string& target_frame,
-                                      tf::StampedTransform transform) {
+FramePairHandle TransformBuffer::getFramePairHandle(const std::string& source_frame, const std::string& target_frame) {
+  std::lock_guard<std::mutex> lck(mutex_);
+  auto inserted = frame_pairs_.emplace(getKey(source_frame, target_frame), buffer_.size());
+  if (inserted.second) {
+    buffer_.emplace_back();
+  }
+  return inserted.first->second;
+}
+
+bool TransformBuffer::insertTransform(FramePairHandle frame_pair, const tf::StampedTransform& transform) {
   std::lock_guard<std::mutex> lck(mutex_);
-  std::unordered_map<std::string, std::deque<tf::StampedTransform>>::iterator iterator =
-      buffer_.find(getKey(source_frame, target_frame));
-  if (iterator == buffer_.end()) {
-    std::deque<tf::StampedTransform> empty_deque;
-    buffer_[getKey(source_frame, target_frame)] = empty_deque;
-    iterator = buffer_.find(getKey(source_frame, target_frame));
+  if (frame_pair >= buffer_.size()) {
+    print(startup_time_, log_level::error, "TF Buffer: could not insert transform into buffer, unregistered");
+    return false;
   }
+  std::deque<tf::StampedTransform>& transforms = buffer_[frame_pair];
 
   // check if the given transform is newer than the last buffered one
-  if (iterator->second.size() == 0 || iterator->second.back().stamp_ < transform.stamp_) {
-    iterator->second.push_back(transform);
+  if (transforms.size() == 0 || transforms.back().stamp_ < transform.stamp_) {
+    transforms.push_back(transform);
     // remove transforms which are outside the buffer size
-    while (transform.stamp_ - iterator->second.front().stamp_ > buffer_size_) {
-      iterator->second.pop_front();
+    while (transform.stamp_ - transforms.front().stamp_ > buffer_size_) {
+      transforms.pop_front();
     }
     return true;
   }
   return false;
 }
 
+bool TransformBuffer::insertTransform(const std::string& source_frame, const std::string& target_frame,
+                                      tf::StampedTransform transform) {
+  return insertTransform(getFramePairHandle(source_frame, target_frame), transform);
+}
+
+bool TransformBuffer::getTransform(FramePairHandle frame_pair, const ros::Time& time,
+                                   tf::StampedTransform& transform) const {
+  std::lock_guard<std::mutex> lck(mutex_);
+  if (frame_pair >= buffer_.size()) {
+    print(startup_time_, log_level::error,
+          "TF Buffer: could not retrieve requested transform from buffer, unregistered");
+    return false;
+  }
+  return lookupTransform(buffer_[frame_pair], time, transform);
+}
+
 bool TransformBuffer::getTransform(const std::string& source_frame, const std::string& target_frame,
                                    const ros::Time& time, tf::StampedTransform& transform) const {
   std::lock_guard<std::mutex> lck(mutex_);
-  std::unordered_map<std::string, std::deque<tf::StampedTransform>>::const_iterator iterator =
-      buffer_.find(getKey(source_frame, target_frame));
-  if (iterator == buffer_.end()) {
-    print(log_level::error, "TF Buffer: could not retrieve requested transform from buffer, unregistered");
+  std::unordered_map<std::string, FramePairHandle>::const_iterator iterator =
+      frame_pairs_.find(getKey(source_frame, target_frame));
+  if (iterator == frame_pairs_.end()) {
+    print(startup_time_, log_level::error,
+          "TF Buffer: could not retrieve requested transform from buffer, unregistered");
+    return false;
+  }
+  return lookupTransform(buffer_[iterator->second], time, transform);
+}
+
+bool TransformBuffer::lookupTransform(const std::deque<tf::StampedTransform>& transforms, const ros::Time& time,
+                                      tf::StampedTransform& transform) const {
+  if (transforms.size() == 0) {
+    print(startup_time_, log_level::warn,
+          "TF Buffer: could not retrieve requested transform from buffer, buffer is empty");
     return false;
-  } else if (iterator->second.size() == 0) {
-    print(log_level::warn, "TF Buffer: could not retrieve requested transform from buffer, buffer is empty");
+  } else if (transforms.back().stamp_ < time) {
+    print(startup_time_, log_level::debug,
+          "TF Buffer: could not retrieve requested transform from buffer, tf has not yet arrived");
     return false;
-  } else {
-    if (iterator->second.back().stamp_ < time) {
-      print(log_level::debug, "TF Buffer: could not retrieve requested transform from buffer, tf has not yet arrived");
-      return false;
-    } else if (iterator->second.front().stamp_ > time) {
-      print(log_level::warn,
-            "TF Buffer: could not retrieve requested transform from buffer, tf has already been dropped from buffer");
-      return false;
-    } else {
-      const tf::StampedTransform* previous = &iterator->second.back();
-      for (std::deque<tf::StampedTransform>::const_reverse_iterator it = ++iterator->second.rbegin();
-           it != iterator->second.rend(); ++it) {
-        if (it->stamp_ <= time) {
-          const tf::StampedTransform& tf_earlier = *it;
-          const tf::StampedTransform& tf_later = *previous;
-          transform.stamp_ = time;
-          if (interpolateTransform(tf_earlier, tf_later, transform)) {
-            return true;
-          } else {
-            print(log_level::warn, "TF Buffer: could not interpolate transform");
-            return false;
-          }
-        }
-        previous = &(*it);
-      }
-    }
+  } else if (transforms.front().stamp_ > time) {
+    print(startup_time_, log_level::warn,
+          "TF Buffer: could not retrieve requested transform from buffer, tf has already been dropped from buffer");
+    return false;
+  }
+
+  // the transforms are ordered by time, find the first one after the requested time. A request for the newest stamp
+  // is interpolated between the last two transforms
+  std::deque<tf::StampedTransform>::const_iterator later =
+      std::upper_bound(transforms.begin(), transforms.end(), time,
+                       [](const ros::Time& t, const tf::StampedTransform& tf) { return t < tf.stamp_; });
+  if (later == transforms.end()) {
+    --later;
+  }
+  if (later == transforms.begin()) {
+    // only a single transform, stamped exactly at the requested time
+    transform = *later;
+    return true;
+  }
+
+  const tf::StampedTransform& tf_earlier = *(later - 1);
+  const tf::StampedTransform& tf_later = *later;
+  transform.stamp_ = time;
+  if (interpolateTransform(tf_earlier, tf_later, transform)) {
+    return true;
   }
+  print(startup_time_, log_level::warn, "TF Buffer: could not interpolate transform");
   return false;
 }
 
-void TransformBuffer::print(const log_level& level, const std::string& msg) const {
-  if (ros::Time::now() - startup_time_ > ros::Duration(3)) {
+void print(const ros::Time& startup_time, const log_level& level, const std::string& msg) {
+  if (ros::Time::now() - startup_time > ros::Duration(3)) {
     switch (level) {
       case error: {
         ROS_ERROR("%s", msg.c_str());
@@ -1,7 +1,9 @@
 #include <gtest/gtest.h>
+#include <cstring>
 #include <limits>
 #include "avoidance/common.h"
 #include "avoidance/histogram.h"
+#include "avoidance/histogram_geometry.h"
 
 using namespace avoidance;
 
@@ -476,6 +478,97 @@ TEST(Common, IndexPolarIndex) {
   }
 }
 
+TEST(Common, histogramGeometry) {
+  // GIVEN: the shared bin geometry table
+  const HistogramGeometry& geometry = HistogramGeometry::get();
+
+  for (int e = 0; e < GRID_LENGTH_E; e++) {
+    for (int z = 0; z < GRID_LENGTH_Z; z++) {
+      // WHEN: we compute the bin center with the conversion functions
+      PolarPoint p_pol = histogramIndexToPolar(e, z, ALPHA_RES, 1.f);
+      Eigen::Vector3f direction = polarHistogramToCartesian(p_pol, Eigen::Vector3f::Zero());
+
+      // THEN: the table should hold the same angles and direction
+      EXPECT_FLOAT_EQ(p_pol.e, geometry.elevation(e));
+      EXPECT_FLOAT_EQ(p_pol.z, geometry.azimuth(z));
+      EXPECT_TRUE(direction.isApprox(geometry.direction(e, z), 1e-6f));
+      EXPECT_EQ(polarToHistogramIndex(p_pol, ALPHA_RES), Eigen::Vector2i(z, e));
+    }
+    EXPECT_FLOAT_EQ(std::cos(geometry.elevation(e) * DEG_TO_RAD), geometry.binWidth(e));
+  }
+}
+
+TEST(Common, atan2Approximation) {
+  // GIVEN: coordinates covering the full circle, including the axes
+  const int n = 3601;
+  Eigen::ArrayXf x(n), y(n);
+  for (int i = 0; i < n; i++) {
+    float angle = (i * 0.1f - 180.f) * DEG_TO_RAD;
+    x[i] = 3.f * std::cos(angle);
+    y[i] = 3.f * std::sin(angle);
+  }
+
+  // WHEN: we compute the angles with the approximation
+  Eigen::ArrayXf approximation = atan2Approximation(y, x);
+
+  // THEN: they should be within the stated error of the exact angles
+  for (int i = 0; i < n; i++) {
+    float exact = std::atan2(y[i], x[i]);
+    // +-PI are the same direction
+    float error = std::abs(wrapAngleToPlusMinusPI(approximation[i] - exact));
+    EXPECT_LT(error, 1e-6f) << "at x: " << x[i] << " y: " << y[i];
+  }
+}
+
+TEST(Common, cartesianToHistogramIndex) {
+  // GIVEN: a cloud with points in all directions and at different distances around an origin
+  const Eigen::Vector3f origin(1.5f, -2.0f, 3.0f);
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  for (float e = -90.f; e <= 90.f; e += 1.3f) {
+    for (float z = -180.f; z <= 180.f; z += 1.7f) {
+      for (float r : {0.5f, 3.f, 14.f}) {
+        cloud.push_back(toXYZ(polarHistogramToCartesian(PolarPoint(e, z, r), origin)));
+      }
+    }
+  }
+  cloud.push_back(pcl::PointXYZ(NAN, NAN, NAN));
+
+  for (int res : {ALPHA_RES, ALPHA_RES / 3}) {
+    // WHEN: we compute the bins in one batch
+    Eigen::ArrayXi e_index, z_index;
+    Eigen::ArrayXf radius;
+    cartesianToHistogramIndex(cloud, origin, res, e_index, z_index, radius);
+
+    // THEN: they should match the scalar conversion, except for points right on the edge of a bin
+    ASSERT_EQ(cloud.size(), e_index.size());
+    ASSERT_EQ(cloud.size(), z_index.size());
+    ASSERT_EQ(cloud.size(), radius.size());
+    auto on_bin_edge = [res](float angle) {
+      float bin = angle / res;
+      return std::abs(bin - std::round(bin)) < 1e-4f / res;
+    };
+
+    for (size_t i = 0; i < cloud.size() - 1; i++) {
+      PolarPoint p_pol = cartesianToPolarHistogram(toEigen(cloud[i]), origin);
+      Eigen::Vector2i p_ind = polarToHistogramIndex(p_pol, res);
+      EXPECT_NEAR(p_pol.r, radius[i], 1e-4f);
+      if (!on_bin_edge(p_pol.e)) {
+        EXPECT_EQ(p_ind.y(), e_index[i]) << "elevation " << p_pol.e;
+      }
+      if (!on_bin_edge(p_pol.z)) {
+        EXPECT_EQ(p_ind.x(), z_index[i]) << "azimuth " << p_pol.z;
+      }
+    }
+
+    // AND: the invalid point should still get a valid index
+    EXPECT_FALSE(std::isfinite(radius[cloud.size() - 1]));
+    EXPECT_GE(e_index[cloud.size() - 1], 0);
+    EXPECT_LT(e_index[cloud.size() - 1], 180 / res);
+    EXPECT_GE(z_index[cloud.size() - 1], 0);
+    EXPECT_LT(z_index[cloud.size() - 1], 360 / res);
+  }
+}
+
 TEST(Common, wrapPolar) {
   // GIVEN: some polar points with elevation and azimuth angles which need to be
   // wrapped
@@ -574,6 +667,156 @@ TEST(Common, removeNaNAndGetMaxima) {
   EXPECT_NEAR(15.f, min_z, 1.0f);
 }
 
+TEST(Common, transformPointCloud2AndGetMaxima) {
+  // GIVEN: an organized PointCloud2 with an intensity field, row padding and NAN points
+  const uint32_t width = 81, height = 61, point_step = 32, row_step = width * point_step + 8;
+  sensor_msgs::PointCloud2 msg;
+  msg.header.frame_id = "camera";
+  msg.width = width;
+  msg.height = height;
+  msg.point_step = point_step;
+  msg.row_step = row_step;
+  const char* names[4] = {"x", "y", "z", "intensity"};
+  const uint32_t offsets[4] = {0, 4, 8, 16};
+  for (int k = 0; k < 4; ++k) {
+    sensor_msgs::PointField field;
+    field.name = names[k];
+    field.offset = offsets[k];
+    field.datatype = sensor_msgs::PointField::FLOAT32;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+  msg.data.resize(row_step * height);
+
+  pcl::PointCloud<pcl::PointXYZ> reference;
+  for (uint32_t row = 0; row < height; ++row) {
+    for (uint32_t col = 0; col < width; ++col) {
+      float xyzi[4] = {-40.f + col, -30.f + row, 15.f, 1.f};
+      if ((row + col) % 7 == 0) {
+        xyzi[0] = NAN;  // garbage point
+      } else {
+        reference.push_back(pcl::PointXYZ(xyzi[0], xyzi[1], xyzi[2]));
+      }
+      for (int k = 0; k < 4; ++k) {
+        std::memcpy(&msg.data[row * row_step + col * point_step + offsets[k]], &xyzi[k], sizeof(float));
+      }
+    }
+  }
+  const float max_range = 30.f;
+  Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+  transform.rotate(Eigen::AngleAxisf(0.3f, Eigen::Vector3f(0.2f, -0.5f, 1.f).normalized()));
+  transform.translation() = Eigen::Vector3f(1.f, -2.f, 3.f);
+
+  // WHEN: we read the message in one pass and compare against filtering the converted cloud
+  pcl::PointCloud<pcl::PointXYZ> cloud, maxima;
+  ASSERT_TRUE(transformPointCloud2AndGetMaxima(msg, transform, max_range, cloud, maxima));
+  pcl::PointCloud<pcl::PointXYZ> reference_maxima = removeNaNAndGetMaxima(reference);
+
+  // THEN: the maxima should be the same and the points in range should be transformed in order
+  ASSERT_EQ(reference_maxima.size(), maxima.size());
+  for (size_t i = 0; i < maxima.size(); ++i) {
+    EXPECT_FLOAT_EQ(reference_maxima.points[i].x, maxima.points[i].x);
+    EXPECT_FLOAT_EQ(reference_maxima.points[i].y, maxima.points[i].y);
+    EXPECT_FLOAT_EQ(reference_maxima.points[i].z, maxima.points[i].z);
+  }
+
+  size_t j = 0;
+  for (const auto& p : reference.points) {
+    if (toEigen(p).norm() > max_range) continue;
+    ASSERT_LT(j, cloud.size());
+    Eigen::Vector3f expected = transform * toEigen(p);
+    EXPECT_NEAR(expected.x(), cloud.points[j].x, 1e-4f);
+    EXPECT_NEAR(expected.y(), cloud.points[j].y, 1e-4f);
+    EXPECT_NEAR(expected.z(), cloud.points[j].z, 1e-4f);
+    ++j;
+  }
+  EXPECT_EQ(j, cloud.size());
+  EXPECT_LT(cloud.size(), reference.size());
+  EXPECT_EQ(cloud.size(), cloud.width);
+
+  // THEN: a message without coordinate fields should be rejected
+  msg.fields.resize(1);
+  EXPECT_FALSE(transformPointCloud2AndGetMaxima(msg, transform, max_range, cloud, maxima));
+  EXPECT_EQ(0, cloud.size());
+  EXPECT_EQ(0, maxima.size());
+}
+
+TEST(Common, deskewPointCloud2) {
+  // GIVEN: a sensor flying at 5m/s along x while capturing 10 rows over 30ms, looking at a wall at x = 10m
+  const uint32_t width = 4, height = 10;
+  const size_t num_slices = 5;
+  const float speed = 5.f;
+  const ros::Time stamp(100.0);
+  const ros::Duration scan_duration(0.03);
+  auto lookup = [&](const ros::Time& time, tf::StampedTransform& transform) {
+    if (time > stamp + ros::Duration(1.0)) return false;
+    transform.setIdentity();
+    transform.setOrigin(tf::Vector3(speed * (time - stamp).toSec(), 0.0, 0.0));
+    transform.stamp_ = time;
+    return true;
+  };
+
+  std::vector<tf::StampedTransform> slice_transforms;
+  ASSERT_TRUE(getSliceTransforms(stamp, scan_duration, num_slices, lookup, slice_transforms));
+  ASSERT_EQ(num_slices, slice_transforms.size());
+  EXPECT_NEAR(-0.012, (slice_transforms.front().stamp_ - stamp).toSec(), 1e-6);
+  EXPECT_NEAR(0.012, (slice_transforms.back().stamp_ - stamp).toSec(), 1e-6);
+
+  // every row sees the wall from the position of the sensor when its slice was captured
+  sensor_msgs::PointCloud2 msg;
+  msg.width = width;
+  msg.height = height;
+  msg.point_step = 3 * sizeof(float);
+  msg.row_step = width * msg.point_step;
+  const char* names[3] = {"x", "y", "z"};
+  for (uint32_t k = 0; k < 3; ++k) {
+    sensor_msgs::PointField field;
+    field.name = names[k];
+    field.offset = k * sizeof(float);
+    field.datatype = sensor_msgs::PointField::FLOAT32;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+  msg.data.resize(msg.row_step * height);
+  for (uint32_t row = 0; row < height; ++row) {
+    const float sensor_x = static_cast<float>(slice_transforms[row * num_slices / height].getOrigin().x());
+    for (uint32_t col = 0; col < width; ++col) {
+      float xyz[3] = {10.f - sensor_x, static_cast<float>(col), static_cast<float>(row)};
+      std::memcpy(&msg.data[row * msg.row_step + col * msg.point_step], xyz, sizeof(xyz));
+    }
+  }
+
+  // WHEN: the cloud is transformed once with the transform at the stamp and once per slice
+  pcl::PointCloud<pcl::PointXYZ> skewed_cloud, deskewed_cloud, maxima;
+  ASSERT_TRUE(transformPointCloud2AndGetMaxima(msg, Eigen::Affine3f::Identity(), 100.f, skewed_cloud, maxima));
+  ASSERT_TRUE(transformPointCloud2AndGetMaxima(msg, slice_transforms, 100.f, deskewed_cloud, maxima));
+
+  // THEN: only the de-skewed wall should be flat
+  ASSERT_EQ(width * height, deskewed_cloud.size());
+  float skewed_min_x = 100.f, skewed_max_x = -100.f;
+  for (size_t i = 0; i < deskewed_cloud.size(); ++i) {
+    EXPECT_NEAR(10.f, deskewed_cloud.points[i].x, 1e-4f);
+    skewed_min_x = std::min(skewed_min_x, skewed_cloud.points[i].x);
+    skewed_max_x = std::max(skewed_max_x, skewed_cloud.points[i].x);
+  }
+  EXPECT_NEAR(speed * 0.024f, skewed_max_x - skewed_min_x, 1e-4f);
+
+  // AND: a single slice should be the same as the single transform path
+  std::vector<tf::StampedTransform> single_transform;
+  ASSERT_TRUE(getSliceTransforms(stamp, scan_duration, 1, lookup, single_transform));
+  EXPECT_EQ(stamp, single_transform.front().stamp_);
+  ASSERT_TRUE(transformPointCloud2AndGetMaxima(msg, single_transform, 100.f, deskewed_cloud, maxima));
+  ASSERT_EQ(skewed_cloud.size(), deskewed_cloud.size());
+  for (size_t i = 0; i < deskewed_cloud.size(); ++i) {
+    EXPECT_FLOAT_EQ(skewed_cloud.points[i].x, deskewed_cloud.points[i].x);
+  }
+
+  // AND: missing transforms should be reported
+  EXPECT_FALSE(getSliceTransforms(stamp + ros::Duration(1.0), scan_duration, num_slices, lookup, slice_transforms));
+  EXPECT_FALSE(transformPointCloud2AndGetMaxima(msg, std::vector<tf::StampedTransform>(), 100.f, deskewed_cloud,
+                                                maxima));
+}
+
 TEST(Common, isInWhichFOV) {
   // GIVEN: a three-camera setup with two overlapping FOV and one alone
   /**
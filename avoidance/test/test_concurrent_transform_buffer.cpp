@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <random>
+#include <thread>
+#include <vector>
+#include "avoidance/concurrent_transform_buffer.h"
+
+using namespace avoidance;
+
+class ConcurrentTransformBufferTests : public ::testing::Test {
+  void SetUp() override { ros::Time::init(); }
+};
+
+TEST_F(ConcurrentTransformBufferTests, GetTransformAPI) {
+  // GIVEN: a concurrent transform buffer and three transforms of one frame pair
+  tf_buffer::ConcurrentTransformBuffer tf_buffer(10.0f);
+  tf_buffer::FramePairHandle pair = tf_buffer.getFramePairHandle("frame1", "frame2");
+
+  ros::Time time1 = ros::Time::now();
+  ros::Time time2 = time1 - ros::Duration(2.f);
+  ros::Time time3 = time1 - ros::Duration(4.f);
+
+  tf::StampedTransform transform1, transform2, transform3, retrieved_transform;
+  transform1.setIdentity();
+  transform1.setOrigin({0.f, 0.f, 4.f});
+  transform1.stamp_ = time1;
+  transform2.setIdentity();
+  transform2.setOrigin({0.f, 0.f, 2.f});
+  transform2.stamp_ = time2;
+  transform3.setIdentity();
+  transform3.stamp_ = time3;
+
+  // WHEN: we insert the 3 transforms into the buffer
+  ASSERT_TRUE(tf_buffer.insertTransform(pair, transform3));
+  ASSERT_TRUE(tf_buffer.insertTransform(pair, transform2));
+  EXPECT_FALSE(tf_buffer.insertTransform(pair, transform2));
+  ASSERT_TRUE(tf_buffer.insertTransform("frame1", "frame2", transform1));
+  EXPECT_EQ(pair, tf_buffer.getFramePairHandle("frame1", "frame2"));
+
+  // THEN: the transforms should be retrieved at their own time and interpolated in between
+  ASSERT_TRUE(tf_buffer.getTransform(pair, time1, retrieved_transform));
+  EXPECT_EQ(retrieved_transform, transform1);
+  ASSERT_TRUE(tf_buffer.getTransform(pair, time2, retrieved_transform));
+  EXPECT_EQ(retrieved_transform, transform2);
+  ASSERT_TRUE(tf_buffer.getTransform("frame1", "frame2", time3, retrieved_transform));
+  EXPECT_EQ(retrieved_transform, transform3);
+  ASSERT_TRUE(tf_buffer.getTransform(pair, time1 - ros::Duration(1.f), retrieved_transform));
+  EXPECT_EQ(retrieved_transform.stamp_, time1 - ros::Duration(1.f));
+  EXPECT_EQ(retrieved_transform.getOrigin(), tf::Vector3(0.f, 0.f, 3.f));
+
+  // AND: times outside of the buffer and unknown frame pairs should not give a transform
+  EXPECT_FALSE(tf_buffer.getTransform(pair, time3 - ros::Duration(1.f), retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform(pair, time1 + ros::Duration(1.f), retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform("frame1", "frame3", time1, retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform(pair + 1, time1, retrieved_transform));
+  EXPECT_FALSE(tf_buffer.insertTransform(pair + 1, transform1));
+}
+
+TEST_F(ConcurrentTransformBufferTests, ringCapacity) {
+  // GIVEN: a buffer holding at most 4 transforms and 2 frame pairs
+  tf_buffer::ConcurrentTransformBuffer tf_buffer(10.0f, 4, 2);
+  tf_buffer::FramePairHandle pair = tf_buffer.getFramePairHandle("frame1", "frame2");
+  EXPECT_NE(pair, tf_buffer.getFramePairHandle("frame1", "frame3"));
+  tf_buffer::FramePairHandle overflow = tf_buffer.getFramePairHandle("frame1", "frame4");
+
+  // WHEN: 6 transforms are inserted one second apart
+  const ros::Time start(1000.0);
+  for (int i = 0; i < 6; i++) {
+    tf::StampedTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(tf::Vector3(i, 0.f, 0.f));
+    transform.stamp_ = start + ros::Duration(i);
+    ASSERT_TRUE(tf_buffer.insertTransform(pair, transform));
+  }
+
+  // THEN: the two oldest transforms should have been overwritten
+  tf::StampedTransform retrieved_transform;
+  EXPECT_FALSE(tf_buffer.getTransform(pair, start + ros::Duration(1.5f), retrieved_transform));
+  ASSERT_TRUE(tf_buffer.getTransform(pair, start + ros::Duration(2.f), retrieved_transform));
+  EXPECT_EQ(retrieved_transform.getOrigin(), tf::Vector3(2.f, 0.f, 0.f));
+  ASSERT_TRUE(tf_buffer.getTransform(pair, start + ros::Duration(4.5f), retrieved_transform));
+  EXPECT_FLOAT_EQ(retrieved_transform.getOrigin().x(), 4.5f);
+
+  // AND: frame pairs beyond the maximum should not be buffered
+  EXPECT_FALSE(tf_buffer.insertTransform(overflow, retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform(overflow, start, retrieved_transform));
+}
+
+TEST_F(ConcurrentTransformBufferTests, staticTransforms) {
+  // GIVEN: a camera mount published on /tf_static only, tf resolves such a chain at time zero
+  tf_buffer::ConcurrentTransformBuffer tf_buffer(10.0f, 4);
+  tf_buffer::FramePairHandle pair = tf_buffer.getFramePairHandle("camera_link", "fcu");
+  tf::StampedTransform mount, retrieved_transform;
+  mount.setIdentity();
+  mount.setOrigin(tf::Vector3(0.1f, 0.f, -0.05f));
+  mount.stamp_ = ros::Time(0);
+
+  // WHEN: the static transform is inserted, again on every tf message
+  ASSERT_TRUE(tf_buffer.insertTransform(pair, mount));
+  EXPECT_FALSE(tf_buffer.insertTransform(pair, mount));
+
+  // THEN: it should be returned for any cloud stamp
+  const ros::Time cloud_stamp(1000.0);
+  for (const ros::Time& time : {cloud_stamp, cloud_stamp + ros::Duration(100.0)}) {
+    ASSERT_TRUE(tf_buffer.getTransform(pair, time, retrieved_transform));
+    EXPECT_EQ(time, retrieved_transform.stamp_);
+    EXPECT_EQ(mount.getOrigin(), retrieved_transform.getOrigin());
+  }
+
+  // WHEN: the mount is republished with a new calibration THEN: the new one replaces it
+  mount.setOrigin(tf::Vector3(0.12f, 0.f, -0.05f));
+  ASSERT_TRUE(tf_buffer.insertTransform(pair, mount));
+  ASSERT_TRUE(tf_buffer.getTransform(pair, cloud_stamp, retrieved_transform));
+  EXPECT_EQ(mount.getOrigin(), retrieved_transform.getOrigin());
+
+  // WHEN: the pair becomes dynamic THEN: only the stamped transforms are used
+  tf::StampedTransform moving = mount;
+  moving.stamp_ = cloud_stamp;
+  ASSERT_TRUE(tf_buffer.insertTransform(pair, moving));
+  EXPECT_TRUE(tf_buffer.getTransform(pair, cloud_stamp, retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform(pair, cloud_stamp + ros::Duration(1.0), retrieved_transform));
+  EXPECT_FALSE(tf_buffer.getTransform(pair, cloud_stamp - ros::Duration(1.0), retrieved_transform));
+}
+
+TEST_F(ConcurrentTransformBufferTests, concurrentReaders) {
+  // GIVEN: a writer inserting transforms at 200Hz timestamps, moving at 1m/s
+  tf_buffer::ConcurrentTransformBuffer tf_buffer(10.0f, 256);
+  const tf_buffer::FramePairHandle pair = tf_buffer.getFramePairHandle("camera_link", "local_origin");
+  const ros::Time start(1000.0);
+  const int num_transforms = 20000;
+  std::atomic<int> num_inserted{0};
+  std::thread writer([&]() {
+    for (int i = 0; i < num_transforms; i++) {
+      tf::StampedTransform transform;
+      transform.setIdentity();
+      transform.setOrigin(tf::Vector3(0.005 * i, 0.0, 1.0));
+      transform.stamp_ = start + ros::Duration(0.005 * i);
+      tf_buffer.insertTransform(pair, transform);
+      num_inserted.store(i + 1, std::memory_order_release);
+    }
+  });
+
+  // WHEN: several readers look up recent times while the writer keeps inserting
+  const int num_readers = 4;
+  std::vector<double> max_errors(num_readers, 0.0);
+  std::vector<std::thread> readers;
+  for (int r = 0; r < num_readers; r++) {
+    readers.emplace_back([&, r]() {
+      std::mt19937 generator(r);
+      std::uniform_real_distribution<double> age_s(0.0, 0.5);
+      tf::StampedTransform transform;
+      while (num_inserted.load(std::memory_order_acquire) < num_transforms) {
+        const int inserted = num_inserted.load(std::memory_order_acquire);
+        if (inserted < 2) continue;
+        const double query_s = std::max(0.0, 0.005 * (inserted - 1) - age_s(generator));
+        if (tf_buffer.getTransform(pair, start + ros::Duration(query_s), transform)) {
+          max_errors[r] = std::max(max_errors[r], std::abs(transform.getOrigin().x() - query_s));
+          max_errors[r] = std::max(max_errors[r], std::abs(transform.getOrigin().z() - 1.0));
+        }
+      }
+    });
+  }
+  writer.join();
+  for (std::thread& reader : readers) reader.join();
+
+  // THEN: every retrieved transform should be consistent, never torn by a concurrent write
+  for (int r = 0; r < num_readers; r++) {
+    EXPECT_LT(max_errors[r], 1e-4);
+  }
+}
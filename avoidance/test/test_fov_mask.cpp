@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <random>
+#include <vector>
+#include "avoidance/fov_mask.h"
+
+using namespace avoidance;
+
+namespace {
+bool referenceInsideFOV(const std::vector<FOV>& fov, const Eigen::Vector3f& point, const Eigen::Vector3f& position,
+                        float yaw_deg, float pitch_deg) {
+  PolarPoint p_pol_fcu = cartesianToPolarFCU(point, position);
+  p_pol_fcu.e -= pitch_deg;
+  p_pol_fcu.z -= yaw_deg;
+  wrapPolar(p_pol_fcu);
+  return pointInsideFOV(fov, p_pol_fcu);
+}
+}
+
+TEST(FOVMask, sameResultAsPointInsideFOV) {
+  // GIVEN: a mask, random fields of view, attitudes and points
+  std::mt19937 rng(42);
+  std::uniform_real_distribution<float> coordinate(-10.f, 10.f);
+  std::uniform_real_distribution<float> angle(-180.f, 180.f);
+  std::uniform_real_distribution<float> pitch(-30.f, 30.f);
+  std::uniform_real_distribution<float> fov_size(20.f, 120.f);
+  std::uniform_real_distribution<float> drift(-0.5f, 0.5f);
+  const int res = 3;
+  const int num_points = 2000;
+  const Eigen::Vector3f position(1.f, -2.f, 3.f);
+
+  FOVMask fov_mask(0.5f);
+  for (int trial = 0; trial < 20; ++trial) {
+    std::vector<FOV> fov;
+    for (int i = 0; i < 1 + trial % 3; ++i) {
+      fov.push_back(FOV(angle(rng), pitch(rng), fov_size(rng), fov_size(rng) / 2.f));
+    }
+    const float yaw_deg = angle(rng);
+    const float pitch_deg = pitch(rng);
+    ASSERT_TRUE(fov_mask.update(fov, yaw_deg, pitch_deg, res));
+
+    // WHEN: the attitude drifts within the tolerance and we look up the points
+    for (int step = 0; step < 3; ++step) {
+      const float drifted_yaw_deg = yaw_deg + drift(rng);
+      const float drifted_pitch_deg = pitch_deg + drift(rng);
+      EXPECT_FALSE(fov_mask.update(fov, drifted_yaw_deg, drifted_pitch_deg, res));
+
+      Eigen::ArrayXf x(num_points), y(num_points), z(num_points);
+      for (int i = 0; i < num_points; ++i) {
+        x[i] = coordinate(rng);
+        y[i] = coordinate(rng);
+        z[i] = coordinate(rng);
+      }
+      Eigen::ArrayXi e_index, z_index;
+      Eigen::ArrayXf radius;
+      cartesianToHistogramIndex(x, y, z, position, res, e_index, z_index, radius);
+
+      // THEN: the mask should agree with the exact test for every point
+      for (int i = 0; i < num_points; ++i) {
+        const Eigen::Vector3f point(x[i], y[i], z[i]);
+        ASSERT_EQ(referenceInsideFOV(fov, point, position, drifted_yaw_deg, drifted_pitch_deg),
+                  fov_mask.pointInsideFOV(e_index[i], z_index[i], point, position))
+            << "trial " << trial << " point " << i;
+      }
+    }
+  }
+}
+
+TEST(FOVMask, mostCellsResolvedWithoutExactTest) {
+  // GIVEN: a mask of a single forward facing camera
+  const int res = 6;
+  std::vector<FOV> fov(1, FOV(0.f, 0.f, 90.f, 60.f));
+  FOVMask fov_mask;
+  fov_mask.update(fov, 0.f, 0.f, res);
+
+  // WHEN: we count the cells classified as border
+  int inside = 0, border = 0;
+  for (int e = 0; e < 180 / res; ++e) {
+    for (int z = 0; z < 360 / res; ++z) {
+      inside += fov_mask.cell(e, z) == FOVMask::Cell::inside;
+      border += fov_mask.cell(e, z) == FOVMask::Cell::border;
+    }
+  }
+
+  // THEN: the interior of the FOV is inside and only the edges need the exact test
+  EXPECT_GT(inside, 100);
+  EXPECT_LT(border, inside);
+  EXPECT_EQ(inside + border, fov_mask.coveredCells().size());
+
+  // the histogram looks along y while the fcu frame looks along x
+  Eigen::Vector2i forward = polarToHistogramIndex(cartesianToPolarHistogram(Eigen::Vector3f(1.f, 0.f, 0.f),
+                                                                           Eigen::Vector3f::Zero()),
+                                                  res);
+  EXPECT_EQ(FOVMask::Cell::inside, fov_mask.cell(forward.y(), forward.x()));
+  Eigen::Vector2i backward = polarToHistogramIndex(cartesianToPolarHistogram(Eigen::Vector3f(-1.f, 0.f, 0.f),
+                                                                            Eigen::Vector3f::Zero()),
+                                                   res);
+  EXPECT_EQ(FOVMask::Cell::outside, fov_mask.cell(backward.y(), backward.x()));
+}
+
+TEST(FOVMask, rebuildConditions) {
+  // GIVEN: a built mask
+  std::vector<FOV> fov(1, FOV(0.f, 0.f, 90.f, 60.f));
+  FOVMask fov_mask(1.f);
+  EXPECT_TRUE(fov_mask.update(fov, 179.8f, 0.f, 6));
+
+  // WHEN: nothing changes meaningfully THEN: the mask is kept
+  EXPECT_FALSE(fov_mask.update(fov, 179.8f, 0.f, 6));
+  EXPECT_FALSE(fov_mask.update(fov, -179.5f, 0.9f, 6));
+
+  // WHEN: the attitude, the FOV or the resolution change THEN: the mask is rebuilt
+  EXPECT_TRUE(fov_mask.update(fov, 177.f, 0.f, 6));
+  EXPECT_TRUE(fov_mask.update(fov, 177.f, 2.f, 6));
+  fov[0].h_fov_deg = 80.f;
+  EXPECT_TRUE(fov_mask.update(fov, 177.f, 2.f, 6));
+  EXPECT_TRUE(fov_mask.update(fov, 177.f, 2.f, 3));
+  fov.push_back(FOV(180.f, 0.f, 90.f, 60.f));
+  EXPECT_TRUE(fov_mask.update(fov, 177.f, 2.f, 3));
+  EXPECT_FALSE(fov_mask.update(fov, 177.f, 2.f, 3));
+}
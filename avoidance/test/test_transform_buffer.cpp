@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
+#include <chrono>
+#include <iostream>
 #include <limits>
+#include <random>
 #include "avoidance/transform_buffer.h"
 
 using namespace avoidance;
@@ -102,8 +105,8 @@ TEST_F(TransformBufferTests, insertTransform) {
 
   // AND: the buffer should contain 3 transforms for the first target, and 2 for
   // the second
-  EXPECT_EQ(buffer_[getKey(source_frame, target_frame1)].size(), 3);
-  EXPECT_EQ(buffer_[getKey(source_frame, target_frame2)].size(), 2);
+  EXPECT_EQ(buffer_[getFramePairHandle(source_frame, target_frame1)].size(), 3);
+  EXPECT_EQ(buffer_[getFramePairHandle(source_frame, target_frame2)].size(), 2);
 }
 
 TEST_F(TransformBufferTests, interpolateTransform) {
@@ -134,9 +137,9 @@ TEST_F(TransformBufferTests, interpolateTransform) {
   retrieved_transform1.stamp_ = time_half;
   retrieved_transform2.stamp_ = time1;
   retrieved_transform3.stamp_ = time2;
-  ASSERT_TRUE(interpolateTransform(transform1, transform2, retrieved_transform1));
-  ASSERT_TRUE(interpolateTransform(transform1, transform2, retrieved_transform2));
-  ASSERT_TRUE(interpolateTransform(transform1, transform2, retrieved_transform3));
+  ASSERT_TRUE(tf_buffer::interpolateTransform(transform1, transform2, retrieved_transform1));
+  ASSERT_TRUE(tf_buffer::interpolateTransform(transform1, transform2, retrieved_transform2));
+  ASSERT_TRUE(tf_buffer::interpolateTransform(transform1, transform2, retrieved_transform3));
   tf::Quaternion rotation_retrieved1 = retrieved_transform1.getRotation();
 
   // THEN: we should get half the translation and rotation for the time in
@@ -151,3 +154,86 @@ TEST_F(TransformBufferTests, interpolateTransform) {
   EXPECT_EQ(retrieved_transform2, transform1);
   EXPECT_EQ(retrieved_transform3, transform2);
 }
+
+TEST_F(TransformBufferTests, framePairHandles) {
+  // GIVEN: two registered frame pairs
+  tf_buffer::FramePairHandle pair1 = getFramePairHandle("frame1", "frame2");
+  tf_buffer::FramePairHandle pair2 = getFramePairHandle("frame1", "frame3");
+
+  // THEN: the handles should be distinct and stable
+  EXPECT_NE(pair1, pair2);
+  EXPECT_EQ(pair1, getFramePairHandle("frame1", "frame2"));
+
+  // WHEN: transforms are inserted through the handle and the string API
+  ros::Time time1 = ros::Time::now();
+  tf::StampedTransform transform1, transform2, retrieved_transform;
+  transform1.setIdentity();
+  transform1.stamp_ = time1;
+  transform2.setIdentity();
+  transform2.setOrigin({0.f, 0.f, 2.f});
+  transform2.stamp_ = time1 + ros::Duration(2.f);
+  EXPECT_TRUE(insertTransform(pair1, transform1));
+  EXPECT_TRUE(insertTransform("frame1", "frame2", transform2));
+  EXPECT_FALSE(insertTransform(pair1, transform2));
+
+  // THEN: both APIs should retrieve the same transforms from the same buffer
+  ASSERT_TRUE(getTransform(pair1, time1 + ros::Duration(1.f), retrieved_transform));
+  EXPECT_EQ(retrieved_transform.getOrigin(), tf::Vector3(0.f, 0.f, 1.f));
+  ASSERT_TRUE(getTransform("frame1", "frame2", time1 + ros::Duration(2.f), retrieved_transform));
+  EXPECT_EQ(retrieved_transform, transform2);
+
+  // AND: the other pair and unknown handles should not have any transforms
+  EXPECT_FALSE(getTransform(pair2, time1, retrieved_transform));
+  EXPECT_FALSE(getTransform(pair2 + 1, time1, retrieved_transform));
+  EXPECT_FALSE(insertTransform(pair2 + 1, transform1));
+}
+
+TEST_F(TransformBufferTests, lookupBenchmark) {
+  // GIVEN: a 10s buffer filled with transforms at 200Hz, moving at 1m/s
+  const tf_buffer::FramePairHandle pair = getFramePairHandle("camera_link", "local_origin");
+  const ros::Time start(1000.0);
+  const int num_transforms = 2400;
+  for (int i = 0; i < num_transforms; i++) {
+    tf::StampedTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(tf::Vector3(0.005 * i, 0.0, 1.0));
+    transform.stamp_ = start + ros::Duration(0.005 * i);
+    insertTransform(pair, transform);
+  }
+  ASSERT_EQ(2001u, buffer_[pair].size());
+
+  // WHEN: random times within the buffer are looked up through both APIs
+  const double oldest_s = 0.005 * (num_transforms - buffer_[pair].size());
+  const double newest_s = 0.005 * (num_transforms - 1);
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> query_s(oldest_s, newest_s);
+  const int num_queries = 20000;
+  std::vector<ros::Time> queries;
+  for (int i = 0; i < num_queries; i++) queries.push_back(start + ros::Duration(query_s(generator)));
+
+  int string_failures = 0;
+  int handle_failures = 0;
+  double max_error = 0.0;
+  tf::StampedTransform transform;
+  auto string_start = std::chrono::steady_clock::now();
+  for (const ros::Time& query : queries) {
+    string_failures += !getTransform("camera_link", "local_origin", query, transform);
+  }
+  auto handle_start = std::chrono::steady_clock::now();
+  for (const ros::Time& query : queries) {
+    handle_failures += !getTransform(pair, query, transform);
+    max_error = std::max(max_error, std::abs(transform.getOrigin().x() - (query - start).toSec()));
+  }
+  auto handle_end = std::chrono::steady_clock::now();
+
+  std::cout << "[ INFO     ] 200Hz tf, 10s window, " << num_queries << " lookups: string API "
+            << std::chrono::duration<double, std::micro>(handle_start - string_start).count() / num_queries
+            << " us, handle API "
+            << std::chrono::duration<double, std::micro>(handle_end - handle_start).count() / num_queries
+            << " us per lookup" << std::endl;
+
+  // THEN: every lookup should succeed and be interpolated between the right transforms
+  EXPECT_EQ(0, string_failures);
+  EXPECT_EQ(0, handle_failures);
+  EXPECT_LT(max_error, 1e-4);
+}
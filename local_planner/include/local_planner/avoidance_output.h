@@ -12,6 +12,8 @@ enum waypoint_choice { hover, tryPath, direct, reachHeight };
 struct avoidanceOutput {
   float cruise_velocity;     // mission cruise velocity
   ros::Time last_path_time;  // finish built time for the VFH+* tree
+  int tree_expanded_nodes;   // nodes expanded while building the last tree
+  float tree_time_slack_ms;  // time left of the tree time budget, NAN without budget
 
   std::vector<Eigen::Vector3f> path_node_positions;  // array of tree nodes
                                                      // position, each node
@@ -0,0 +1,87 @@
+#ifndef LOCAL_PLANNER_BOUNDED_QUEUE_H
+#define LOCAL_PLANNER_BOUNDED_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+namespace avoidance {
+
+/**
+* @brief     queue connecting two pipeline stages. It holds at most capacity
+*            elements, pushing into a full queue drops the oldest element so
+*            the producer never waits and the consumer always works on recent
+*            data, which bounds the latency of every element passed through
+**/
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(size_t capacity = 1) : capacity_{capacity > 0 ? capacity : 1} {}
+  ~BoundedQueue() = default;
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /**
+  * @brief     appends an element, ignored once the queue is closed
+  * @param[in] item, element to move into the queue
+  * @returns   true if the oldest element had to be dropped to make room
+  **/
+  bool push(T&& item) {
+    bool dropped = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_) return false;
+      if (items_.size() >= capacity_) {
+        items_.pop_front();
+        dropped = true;
+      }
+      items_.push_back(std::move(item));
+    }
+    cv_.notify_one();
+    return dropped;
+  }
+
+  /**
+  * @brief     takes the oldest element, waiting until one is available
+  * @param[out] item, element moved out of the queue
+  * @returns   false if the queue was closed and is empty
+  **/
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    cv_.wait(lock, [this]() { return !items_.empty() || closed_; });
+    if (items_.empty()) return false;
+    item = std::move(items_.front());
+    items_.pop_front();
+    return true;
+  }
+
+  /**
+  * @brief     wakes up all waiting consumers and rejects further elements.
+  *            Elements already queued can still be popped
+  **/
+  void close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return items_.size();
+  }
+
+ private:
+  const size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+};
+}
+
+#endif  // LOCAL_PLANNER_BOUNDED_QUEUE_H
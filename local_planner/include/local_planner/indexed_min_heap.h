@@ -0,0 +1,65 @@
+#ifndef LOCAL_PLANNER_INDEXED_MIN_HEAP_H
+#define LOCAL_PLANNER_INDEXED_MIN_HEAP_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     binary min-heap of integer ids with float keys. Every id knows
+*            its position in the heap, so keys can be changed and ids removed
+*            in O(log n). Equal keys are ordered by id
+**/
+class IndexedMinHeap {
+  std::vector<std::pair<float, int>> heap_;  // (key, id)
+  std::vector<int> position_;                // heap position of every id, -1 if not contained
+
+  bool before(size_t a, size_t b) const { return heap_[a] < heap_[b]; }
+  void swapEntries(size_t a, size_t b);
+  void siftUp(size_t i);
+  void siftDown(size_t i);
+
+ public:
+  IndexedMinHeap() = default;
+  ~IndexedMinHeap() = default;
+
+  bool empty() const { return heap_.empty(); }
+  size_t size() const { return heap_.size(); }
+  bool contains(int id) const { return id >= 0 && id < static_cast<int>(position_.size()) && position_[id] >= 0; }
+
+  /**
+  * @brief     removes all entries
+  **/
+  void clear();
+
+  /**
+  * @brief     inserts an id or changes its key if it is already contained
+  * @param[in] id, non-negative identifier
+  * @param[in] key, priority, the smallest key is on top
+  **/
+  void push(int id, float key);
+
+  /**
+  * @brief     getter method for the id with the smallest key
+  * @warning   the heap must not be empty
+  **/
+  int top() const { return heap_.front().second; }
+
+  /**
+  * @brief     removes the id with the smallest key
+  * @returns   the removed id
+  * @warning   the heap must not be empty
+  **/
+  int pop();
+
+  /**
+  * @brief     removes an id if it is contained
+  * @param[in] id, identifier to remove
+  **/
+  void erase(int id);
+};
+}
+
+#endif  // LOCAL_PLANNER_INDEXED_MIN_HEAP_H
@@ -7,6 +7,8 @@
 #include "candidate_direction.h"
 #include "cost_parameters.h"
 #include "planner_functions.h"
+#include "pointcloud_fusion.h"
+#include "stage_timer.h"
 
 #include <dynamic_reconfigure/server.h>
 #include <local_planner/LocalPlannerNodeConfig.h>
@@ -36,19 +38,16 @@ class LocalPlanner {
  private:
   int children_per_node_;
   int n_expanded_nodes_;
-  int min_num_points_per_cell_ = 3;
 
   float min_sensor_range_ = 0.2f;
   float max_sensor_range_ = 12.0f;
   float smoothing_margin_degrees_ = 30.f;
-  float max_point_age_s_ = 10;
   float yaw_fcu_frame_deg_ = 0.0f;
   float pitch_fcu_frame_deg_ = 0.0f;
 
   std::vector<FOV> fov_fcu_frame_;
 
   ros::Time last_path_time_;
-  ros::Time last_pointcloud_process_time_;
 
   std::vector<int> closed_set_;
   std::vector<TreeNode> tree_;
@@ -56,6 +55,7 @@ class LocalPlanner {
   costParameters cost_params_;
 
   pcl::PointCloud<pcl::PointXYZI> final_cloud_;
+  PointcloudFusion fusion_;
 
   Eigen::Vector3f position_ = Eigen::Vector3f::Zero();
   Eigen::Vector3f velocity_ = Eigen::Vector3f::Zero();
@@ -67,10 +67,12 @@ class LocalPlanner {
   Histogram to_fcu_histogram_ = Histogram(ALPHA_RES);
   Eigen::MatrixXf cost_matrix_;
 
+  StageTimer stage_timer_;
+
   /**
   * @brief     fills message to send histogram to the FCU
   **/
-  void updateObstacleDistanceMsg(Histogram hist);
+  void updateObstacleDistanceMsg(const Histogram& hist);
   /**
   * @brief     fills message to send empty histogram to the FCU
   **/
@@ -90,6 +92,9 @@ class LocalPlanner {
  public:
   std::vector<uint8_t> histogram_image_data_;
   std::vector<uint8_t> cost_image_data_;
+  // the debug images are only generated if requested, they stay empty otherwise
+  bool generate_histogram_image_ = true;
+  bool generate_cost_image_ = true;
   bool currently_armed_ = false;
 
   double timeout_startup_ = 20.0;
@@ -198,6 +203,13 @@ class LocalPlanner {
   **/
   avoidanceOutput getAvoidanceOutput() const;
 
+  /**
+  * @brief     getter method for the pipeline stage timer, which is shared with
+  *            the stages running outside of the planner
+  * @returns   timer collecting the stage durations
+  **/
+  StageTimer& getStageTimer() { return stage_timer_; }
+
   /**
   * @brief     determines the way the obstacle is avoided and the algorithm to
   *            use
@@ -207,11 +219,20 @@ class LocalPlanner {
   * @brief     starts a iteration of the local planner algorithm
   **/
   void runPlanner();
+  /**
+  * @brief     starts a iteration of the local planner algorithm on a cloud
+  *            which was already fused outside of the planner
+  * @param[in,out] fused_cloud, fused obstacle cloud, swapped with the cloud of
+  *            the previous iteration
+  **/
+  void runPlanner(pcl::PointCloud<pcl::PointXYZI>& fused_cloud);
 
   /**
   * @brief     setter method for PX4 Firmware paramters
   **/
   void setDefaultPx4Parameters();
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 }
 
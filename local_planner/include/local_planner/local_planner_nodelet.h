@@ -1,9 +1,12 @@
 #ifndef LOCAL_PLANNER_LOCAL_PLANNER_NODE_H
 #define LOCAL_PLANNER_LOCAL_PLANNER_NODE_H
 
-#include "avoidance/transform_buffer.h"
+#include "avoidance/concurrent_transform_buffer.h"
 #include "local_planner/avoidance_output.h"
+#include "local_planner/bounded_queue.h"
 #include "local_planner/local_planner_visualization.h"
+#include "local_planner/pointcloud_fusion.h"
+#include "local_planner/triple_buffer.h"
 
 #ifndef DISABLE_SIMULATION
 // include simulation
@@ -28,9 +31,12 @@
 #include <sensor_msgs/PointCloud2.h>
 #include <sensor_msgs/Range.h>
 #include <std_msgs/Bool.h>
+#include <std_msgs/Float32MultiArray.h>
 #include <std_msgs/Float64.h>
 #include <std_msgs/String.h>
 #include <tf/transform_listener.h>
+#include <tf2/buffer_core.h>
+#include <tf2_msgs/TFMessage.h>
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <Eigen/Core>
@@ -43,6 +49,7 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
@@ -52,23 +59,98 @@ namespace avoidance {
 class LocalPlanner;
 class WaypointGenerator;
 
+struct transformedFrame {
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  FOV fov_fcu_frame;
+};
+
+/**
+* @brief     output of the fusion stage: the fused obstacle cloud together with
+*            the vehicle state it was fused at, so the planning stage plans
+*            from the same state
+**/
+struct fusedFrame {
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  std::vector<FOV> fov_fcu_frame;
+  Eigen::Vector3f position = Eigen::Vector3f::Zero();
+  Eigen::Vector3f velocity = Eigen::Vector3f::Zero();
+  Eigen::Quaternionf orientation = Eigen::Quaternionf::Identity();
+
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+/**
+* @brief     output of the planning stage, everything the publishing stage
+*            needs without touching the planner
+**/
+struct plannedFrame {
+  avoidanceOutput output;
+  plannerVisualizationData visualization;
+  sensor_msgs::LaserScan obstacle_distance;
+};
+
+/**
+* @brief     frame pair whose transforms are copied from tf into the buffer
+**/
+struct bufferedFramePair {
+  std::string source_frame;
+  std::string target_frame;
+  tf_buffer::FramePairHandle handle;
+  ros::Time latest_stamp;  ///< stamp of the newest transform inserted into the buffer
+  bool is_static = false;  ///< the chain only has static transforms, which are valid at any time
+
+  /**
+  * @brief     inserts the transform of the chain, as looked up at time zero,
+  *            into the buffer. A chain of static transforms resolves with
+  *            stamp zero, the buffer then returns it for any time
+  * @param[in] buffer, buffer the handle belongs to
+  * @param[in] transform, latest transform of the chain
+  * @returns   true if the transform was inserted
+  **/
+  bool insert(tf_buffer::ConcurrentTransformBuffer& buffer, const tf::StampedTransform& transform) {
+    is_static = transform.stamp_.isZero();
+    if (!buffer.insertTransform(handle, transform)) return false;
+    latest_stamp = transform.stamp_;
+    return true;
+  }
+
+  /**
+  * @brief     whether the buffer holds the transforms up to a stamp
+  **/
+  bool covers(const ros::Time& stamp) const { return is_static || latest_stamp >= stamp; }
+};
+
+/**
+* @brief     per camera state. Frames are handed from the subscriber callback
+*            to the transform thread and from there to the planner thread
+*            through lock-free triple buffers, every other member is only
+*            used by the thread noted next to it
+**/
 struct cameraData {
   std::string topic_;
   ros::Subscriber pointcloud_sub_;
 
-  pcl::PointCloud<pcl::PointXYZ> untransformed_cloud_;
-  bool received_;
-
-  pcl::PointCloud<pcl::PointXYZ> transformed_cloud_;
-  bool transformed_;
+  std::unique_ptr<TripleBuffer<sensor_msgs::PointCloud2::ConstPtr>> received_cloud_;
+  std::unique_ptr<TripleBuffer<transformedFrame>> transformed_frame_;
 
+  // puts the transform thread to sleep until a new cloud or its transform arrives
   std::unique_ptr<std::mutex> camera_mutex_;
   std::unique_ptr<std::condition_variable> camera_cv_;
+  ros::Time transform_wait_stamp_;   ///< guarded by camera_mutex_, stamp of the cloud waiting for its transform
+  std::string transform_wait_frame_;  ///< guarded by camera_mutex_, frame of the cloud waiting for its transform
 
-  bool transform_registered_ = false;
+  bool transform_registered_ = false;  ///< subscriber callback
   std::thread transform_thread_;
 
-  FOV fov_fcu_frame_;
+  sensor_msgs::PointCloud2::ConstPtr untransformed_cloud_;  ///< transform thread, waiting for its transform
+  FOV fov_fcu_frame_;                                       ///< transform thread
+  std::string frame_id_;                                    ///< transform thread, frame of the resolved handles
+  tf_buffer::FramePairHandle local_origin_frame_pair_ = 0;  ///< transform thread
+  tf_buffer::FramePairHandle fcu_frame_pair_ = 0;           ///< transform thread
+  std::vector<tf::StampedTransform> slice_transforms_;      ///< transform thread, one per slice of rows
+
+  bool transformed_ = false;  ///< planner thread, a frame was picked up and not used yet
+  ros::Time frame_stamp_;     ///< planner thread, stamp of the last frame used
 };
 
 class LocalPlannerNodelet : public nodelet::Nodelet {
@@ -91,6 +173,8 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
   std::unique_ptr<ros::AsyncSpinner> cmdloop_spinner_;
 
   std::thread worker;
+  std::thread worker_planning;
+  std::thread worker_publishing;
   std::thread worker_tf_listener;
 
   LocalPlannerVisualization visualizer_;
@@ -102,28 +186,71 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
 
   std::mutex running_mutex_;  ///< guard against concurrent access to input &
                               /// output data (point cloud, position, ...)
+  std::mutex fusion_mutex_;   ///< guards the fusion parameters against reconfiguration
 
   bool position_received_ = false;
 
   /**
-  * @brief     handles threads for data publication and subscription
+  * @brief     fusion stage of the planner pipeline: waits for a frame of
+  *            every camera, fuses them with the obstacle memory and hands the
+  *            result to the planning stage
   **/
   void threadFunction();
 
+  /**
+  * @brief     planning stage of the planner pipeline: builds the histogram,
+  *            the cost matrix and the search tree on the latest fused frame
+  **/
+  void planningThread();
+
+  /**
+  * @brief     publishing stage of the planner pipeline: hands the planner
+  *            output to the waypoint generator and publishes the visualization
+  *            and the obstacle distance
+  **/
+  void publishingThread();
+
   /**
   * @brief     start spinners
   **/
   void startNode();
 
   /**
-  * @brief     updates the local planner agorithm with the latest pointcloud,
-  *            vehicle position, velocity, state, and distance to ground, goal,
-  *            setpoint sent to the FCU
+  * @brief     checks whether the fusion stage can run, which is once every
+  *            camera or, if planning on any camera, one camera has a new frame
+  * @returns   true if enough transformed pointclouds are available
+  **/
+  bool camerasReady();
+
+  /**
+  * @brief     takes the latest transformed frame of every camera with new
+  *            data, only to be called by the fusion stage. Cameras without a
+  *            new frame are covered by the obstacle memory, once their last
+  *            frame exceeds the staleness bound they are considered lost
+  * @param[out] clouds, new pointcloud of each camera in the local origin
+  *            frame, empty and without header for cameras without a new
+  *            frame
+  * @param[out] fusion_fov, field of view of each camera with a new frame, empty
+  *            for the others so the memory is kept in their view
+  * @param[out] fov, field of view of each camera which is not lost, empty for
+  *            the lost ones
+  * @returns   number of cameras with a new frame
   **/
-  void updatePlannerInfo();
+  size_t takeTransformedFrames(std::vector<pcl::PointCloud<pcl::PointXYZ>>& clouds, std::vector<FOV>& fusion_fov,
+                               std::vector<FOV>& fov);
 
   /**
-  * @brief     computes the number of transformed pointclouds
+  * @brief     updates the local planner agorithm with the FOV and the vehicle
+  *            position, velocity and orientation of a fused frame and the
+  *            latest state, goal and setpoint sent to the FCU
+  * @param[in] frame, output of the fusion stage
+  **/
+  void updatePlannerInfo(const fusedFrame& frame);
+
+  /**
+  * @brief     computes the number of cameras with a transformed pointcloud
+  *            which was not used by the planner yet, only to be called by the
+  *            planner thread
   * @ returns  number of transformed pointclouds
   **/
   size_t numTransformedClouds();
@@ -172,6 +299,29 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
   **/
   void transformBufferThread();
 
+  /**
+  * @brief     inserts the transforms of a /tf or /tf_static message into the
+  *            tf tree and every buffered frame pair, at the latest time its
+  *            whole chain is known, into the buffer
+  * @param[in] msg, transforms received from tf
+  * @param[in] is_static, true if received on /tf_static
+  **/
+  void tfCallback(const tf2_msgs::TFMessage::ConstPtr& msg, bool is_static);
+
+  /**
+  * @brief     wakes the transform threads of the cameras whose waiting cloud
+  *            is covered by the buffered transforms now. Called with
+  *            buffered_transforms_mutex_ held
+  **/
+  void notifyTransformWaiters();
+
+  /**
+  * @brief     publishes the rolling statistics of the pipeline stage durations
+  *            at a low rate. The stages are only measured while the topic has
+  *            subscribers
+  **/
+  void publishStageTiming();
+
  private:
   avoidance::LocalPlannerNodeConfig rqt_param_config_;
 
@@ -187,6 +337,7 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
   ros::Publisher mavros_obstacle_free_path_pub_;
   ros::Publisher mavros_obstacle_distance_pub_;
   ros::Publisher mavros_system_status_pub_;
+  ros::Publisher stage_timing_pub_;
 
   // Subscribers
   ros::Subscriber pose_sub_;
@@ -197,6 +348,8 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
   ros::Subscriber fcu_input_sub_;
   ros::Subscriber goal_topic_sub_;
   ros::Subscriber distance_sensor_sub_;
+  ros::Subscriber tf_sub_;
+  ros::Subscriber tf_static_sub_;
 
   ros::CallbackQueue pointcloud_queue_;
   ros::CallbackQueue main_queue_;
@@ -228,17 +381,30 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
 
   dynamic_reconfigure::Server<avoidance::LocalPlannerNodeConfig>* server_ = nullptr;
   tf::TransformListener* tf_listener_ = nullptr;
-  avoidance::tf_buffer::TransformBuffer tf_buffer_;
-  std::condition_variable tf_buffer_cv_;
+  avoidance::tf_buffer::ConcurrentTransformBuffer tf_buffer_;  ///< camera threads read it without locking
 
+  bool event_driven_tf_ = false;  ///< ingest /tf and /tf_static as they arrive instead of polling the listener
   std::mutex buffered_transforms_mutex_;
-  std::vector<std::pair<std::string, std::string>> buffered_transforms_;
+  std::vector<bufferedFramePair> buffered_transforms_;
+  tf2::BufferCore tf_tree_;  ///< guarded by buffered_transforms_mutex_, fed by tfCallback
 
   std::mutex transformed_cloud_mutex_;
   std::condition_variable transformed_cloud_cv_;
+  std::atomic<float> max_sensor_range_{0.f};  ///< copy of the planner sensor range used to crop incoming clouds
 
   std::vector<cameraData> cameras_;
 
+  // pipeline stages, each queue only holds the latest frame so a slow stage drops stale frames instead of lagging
+  PointcloudFusion fusion_;                                    ///< fusion stage
+  std::vector<pcl::PointCloud<pcl::PointXYZ>> fusion_clouds_;  ///< fusion stage
+  std::vector<FOV> fusion_fov_;                                ///< fusion stage
+  std::atomic<bool> plan_on_any_camera_{false};
+  std::atomic<float> max_camera_staleness_s_{1.f};
+  std::atomic<float> deskew_scan_time_s_{0.f};
+  std::atomic<int> deskew_slices_{8};
+  BoundedQueue<std::unique_ptr<fusedFrame>> fused_frames_{1};
+  BoundedQueue<std::unique_ptr<plannedFrame>> planned_frames_{1};
+
   bool armed_ = false;
   bool data_ready_ = false;
   bool hover_;
@@ -250,7 +416,7 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
   bool is_takeoff_waypoint_{false};
   double spin_dt_;
   int path_length_ = 0;
-  std::vector<float> algo_time;
+  ros::WallTime last_stage_timing_time_;
 
   float desired_yaw_setpoint_{NAN};
   float desired_yaw_speed_setpoint_{NAN};
@@ -342,8 +508,9 @@ class LocalPlannerNodelet : public nodelet::Nodelet {
 
   /**
   * @brief     sends out emulated LaserScan data to the flight controller
+  * @param[in] obstacle_distance, obstacle distance filled by the planner
   **/
-  void publishLaserScan() const;
+  void publishLaserScan(const sensor_msgs::LaserScan& obstacle_distance) const;
 };
 }
 #endif  // LOCAL_PLANNER_LOCAL_PLANNER_NODE_H
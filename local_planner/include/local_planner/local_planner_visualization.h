@@ -2,6 +2,7 @@
 #define LOCAL_PLANNER_VISUALIZATION_H
 
 #include "local_planner/local_planner.h"
+#include "local_planner/tree_node.h"
 #include "local_planner/waypoint_generator.h"
 
 #include <pcl/point_cloud.h>
@@ -13,6 +14,25 @@
 
 namespace avoidance {
 
+/**
+* @brief     copy of the planner output shown in the visualization, taken at
+*            the end of a planner iteration so it can be published while the
+*            planner already works on the next one
+**/
+struct plannerVisualizationData {
+  pcl::PointCloud<pcl::PointXYZI> pointcloud;
+  uint32_t pointcloud_size = 0;
+  std::vector<TreeNode> tree;
+  std::vector<int> closed_set;
+  std::vector<Eigen::Vector3f> path_node_positions;
+  Eigen::Vector3f goal = Eigen::Vector3f::Zero();
+  std::vector<uint8_t> histogram_image_data;
+  std::vector<uint8_t> cost_image_data;
+  std::vector<FOV> fov;
+  float sensor_range = 0.f;
+  sensor_msgs::LaserScan range_scan;
+};
+
 class LocalPlannerVisualization {
  public:
   /**
@@ -21,14 +41,31 @@ class LocalPlannerVisualization {
   void initializePublishers(ros::NodeHandle& nh);
 
   /**
-  * @brief       Main function which calls functions to visualize all planner
-  *              output ready at the end of one planner iteration
+  * @brief      checks whether the debug images are worth generating
+  * @returns    true if the corresponding image topic has subscribers
+  **/
+  bool histogramImageSubscribed() const { return histogram_image_pub_.getNumSubscribers() > 0; }
+  bool costImageSubscribed() const { return cost_image_pub_.getNumSubscribers() > 0; }
+
+  /**
+  * @brief       Copies the planner output ready at the end of one planner
+  *              iteration. The pointcloud and the tree are only copied if
+  *              their topics have subscribers
   * @params[in]  planner, reference to the planner
+  * @params[out] data, planner output to visualize
+  **/
+  void collectPlannerData(const LocalPlanner& planner, plannerVisualizationData& data) const;
+
+  /**
+  * @brief       Main function which calls functions to visualize all planner
+  *              output collected at the end of one planner iteration. Data is
+  *              only converted for topics with subscribers
+  * @params[in]  data, planner output collected by collectPlannerData
   * @params[in]  newest_waypoint_position, last caluclated waypoint (smoothed)
   * @params[in]  newest_adapted_waypoint_position, last caluclated waypoint
   *              (non-smoothed)
   **/
-  void visualizePlannerData(const LocalPlanner& planner, const Eigen::Vector3f& newest_waypoint_position,
+  void visualizePlannerData(const plannerVisualizationData& data, const Eigen::Vector3f& newest_waypoint_position,
                             const Eigen::Vector3f& newest_adapted_waypoint_position,
                             const Eigen::Vector3f& newest_position, const Eigen::Quaternionf& newest_orientation) const;
 
@@ -0,0 +1,125 @@
+#ifndef LOCAL_PLANNER_OBSTACLE_MEMORY_H
+#define LOCAL_PLANNER_OBSTACLE_MEMORY_H
+
+#include "avoidance/histogram.h"
+
+#include <Eigen/Core>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     persistent store of remembered obstacle points, binned in a polar
+*            grid around the vehicle which holds at most one point per bin,
+*            together with the time the point was last observed. Observations
+*            replace the content of their bin, cells are expired from a queue
+*            ordered by time stamp and the grid is only rebuilt when the
+*            vehicle moved further than a tolerance from its origin, so a
+*            hovering cycle costs as much as the bins it touches
+**/
+class ObstacleMemory {
+  int res_;
+  int z_dim_;
+  float time_s_;
+  Eigen::Vector3f origin_;
+
+  // one point per occupied bin in no particular order, the intensity field holds the time stamp
+  pcl::PointCloud<pcl::PointXYZI> cells_;
+  std::vector<int> bins_;   ///< bin of each cell
+  std::vector<int> slots_;  ///< index in cells_ of each bin, -1 if empty
+
+  // (time stamp, bin) of every insertion in stamp order, entries of replaced cells are skipped on expiry
+  std::deque<std::pair<float, int>> expiry_queue_;
+
+  void erase(size_t index);
+
+ public:
+  /**
+  * @param[in] res, angular resolution of the bins [deg]
+  **/
+  explicit ObstacleMemory(int res = ALPHA_RES / 3);
+  ~ObstacleMemory() = default;
+
+  /**
+  * @brief     advances the memory clock, ageing all remembered cells
+  * @param[in] elapsed_s, time since the last update [s]
+  **/
+  void advance(float elapsed_s) { time_s_ += elapsed_s; }
+
+  /**
+  * @brief     forgets the cells of at least max_age, only visits expired cells
+  * @param[in] max_age, maximum age of the remembered cells [s]
+  **/
+  void expire(float max_age);
+
+  /**
+  * @brief     centers the grid on a new position. The remembered cells are
+  *            binned again, keeping the newest one per bin, and the ones out
+  *            of range are forgotten. Does nothing if the position is within
+  *            tolerance of the current origin
+  * @param[in] position, current vehicle position
+  * @param[in] max_range, cells further away from position are forgotten [m]
+  * @param[in] tolerance, distance the position may drift from the origin
+  *            before the grid is rebuilt [m]
+  * @returns   true if the grid was rebuilt
+  **/
+  bool moveTo(const Eigen::Vector3f& position, float max_range, float tolerance = 0.f);
+
+  /**
+  * @brief     stores an observation, replacing the content of its bin
+  * @param[in] e, elevation index of the point around the current position
+  * @param[in] z, azimuth index of the point around the current position
+  * @param[in] point, observed obstacle position [m]
+  * @param[in] age, age of the observation [s]
+  **/
+  void insert(int e, int z, const Eigen::Vector3f& point, float age = 0.f);
+
+  /**
+  * @brief     same as above, the bin is computed from the point
+  **/
+  void insert(const Eigen::Vector3f& point, float age = 0.f);
+
+  /**
+  * @brief     remembered cell of a bin
+  * @param[in] bin, index e * (360 / res) + z
+  * @returns   pointer to the cell, nullptr if the bin is empty
+  **/
+  const pcl::PointXYZI* cell(int bin) const { return slots_[bin] < 0 ? nullptr : &cells_.points[slots_[bin]]; }
+
+  /**
+  * @brief     forgets the cell of a bin, if any
+  * @param[in] bin, index e * (360 / res) + z
+  **/
+  void forget(int bin);
+
+  /**
+  * @brief     age of a remembered cell
+  * @param[in] cell, element of cells()
+  * @returns   time since the cell was last observed [s]
+  **/
+  float age(const pcl::PointXYZI& cell) const { return time_s_ - cell.intensity; }
+
+  /**
+  * @brief     getter method for the remembered cells
+  * @returns   one point per occupied bin, intensity is the time stamp
+  **/
+  const pcl::PointCloud<pcl::PointXYZI>& cells() const { return cells_; }
+
+  size_t size() const { return cells_.points.size(); }
+  int res() const { return res_; }
+  const Eigen::Vector3f& origin() const { return origin_; }
+
+  /**
+  * @brief     forgets all remembered cells
+  **/
+  void clear();
+};
+}
+
+#endif  // LOCAL_PLANNER_OBSTACLE_MEMORY_H
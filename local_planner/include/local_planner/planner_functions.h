@@ -2,24 +2,31 @@
 #define LOCAL_PLANNER_FUNCTIONS_H
 
 #include "avoidance/common.h"
+#include "avoidance/fov_mask.h"
 #include "avoidance/histogram.h"
 #include "candidate_direction.h"
 #include "cost_parameters.h"
+#include "obstacle_memory.h"
 
 #include <Eigen/Dense>
 
 #include <pcl/point_cloud.h>
 #include <pcl/point_types.h>
 
-#include <queue>
 #include <vector>
 
 namespace avoidance {
 
 /**
 * @brief      crops and subsamples the incomming data, then combines it with
-*             the data from the last timestep
-* @param      final_cloud, processed data to be used for planning
+*             the remembered data from previous timesteps
+* @param[out] final_cloud, processed data to be used for planning, the
+*             intensity holds the age of each point [s]. The header is the
+*             one of the newest cloud
+* @param      memory, remembered obstacle cells, updated in place with the new
+*             data
+* @param      fov_mask, kept across calls and only rebuilt when the FOV or
+*             the vehicle attitude changed
 * @param[in]  complete_cloud, array of pointclouds from the sensors
 * @param[in]  FOV, struct defining current field of view
 * @param[in]  position, current vehicle position
@@ -30,7 +37,7 @@ namespace avoidance {
 *             be kept, less points are discarded as noise (careful: 0 is not
 *             a valid input here)
 **/
-void processPointcloud(pcl::PointCloud<pcl::PointXYZI>& final_cloud,
+void processPointcloud(pcl::PointCloud<pcl::PointXYZI>& final_cloud, ObstacleMemory& memory, FOVMask& fov_mask,
                        const std::vector<pcl::PointCloud<pcl::PointXYZ>>& complete_cloud, const std::vector<FOV>& fov,
                        float yaw_fcu_frame_deg, float pitch_fcu_frame_deg, const Eigen::Vector3f& position,
                        float min_sensor_range, float max_sensor_range, float max_age, float elapsed_s,
@@ -68,11 +75,13 @@ void compressHistogramElevation(Histogram& new_hist, const Histogram& input_hist
 * @param[in]  min_sensor_range, minimum distance at which the sensor detects objects
 * @param[out] cost_matrix
 * @param[out] image of the cost matrix for visualization
+* @param[in]  generate_image, if false the image is left empty, e.g. for tree
+*             node expansions or when nobody looks at it
 **/
 void getCostMatrix(const Histogram& histogram, const Eigen::Vector3f& goal, const Eigen::Vector3f& position,
                    const Eigen::Vector3f& velocity, const costParameters& cost_params, float smoothing_margin_degrees,
                    const Eigen::Vector3f& closest_pt, const float max_sensor_range, const float min_sensor_range,
-                   Eigen::MatrixXf& cost_matrix, std::vector<uint8_t>& image_data);
+                   Eigen::MatrixXf& cost_matrix, std::vector<uint8_t>& image_data, bool generate_image = true);
 
 /**
 * @brief      get the index in the data vector of a color image
@@ -91,14 +100,39 @@ void generateCostImage(const Eigen::MatrixXf& cost_matrix, const Eigen::MatrixXf
                        std::vector<uint8_t>& image_data);
 
 /**
-* @brief      classifies the candidate directions in increasing cost order
+* @brief      classifies the candidate directions in increasing cost order. The
+*             cheapest cells are found by partial selection on the cost buffer
+*             and only the selected ones are converted to directions
 * @param[in]  matrix, cost matrix
 * @param[in]  number_of_candidates, number of candidate direction to consider
 * @param[out] candidate_vector, array of candidate polar direction arranged from
 *             the least to the most expensive
+* @param[in]  min_angle_deg, minimum angle between two candidates, a direction
+*             closer than that to a cheaper candidate is skipped (0 to disable)
 **/
 void getBestCandidatesFromCostMatrix(const Eigen::MatrixXf& matrix, unsigned int number_of_candidates,
-                                     std::vector<candidateDirection>& candidate_vector);
+                                     std::vector<candidateDirection>& candidate_vector, float min_angle_deg = 0.f);
+
+/**
+* @brief      computes the costs of all histogram directions at once. The
+*             direction dependent terms are separable into elevation and
+*             azimuth parts, so they are evaluated per row and column and
+*             combined as whole matrix expressions. Matches costFunction
+*             evaluated for every bin
+* @param[in]  histogram, polar histogram of the obstacle distances
+* @param[in]  goal, current goal position
+* @param[in]  position, current vehicle position
+* @param[in]  velocity, current vehicle velocity
+* @param[in]  cost_params, weights for goal oriented vs smooth behaviour
+* @param[in]  closest_pt, vehicle position projection on the line previous-current goal
+* @param[in]  is_obstacle_facing_goal, true if there is an obstacle in the goal direction
+* @param[out] distance_matrix, distance cost of every bin
+* @param[out] cost_matrix, sum of all other costs of every bin
+**/
+void evaluateCostMatrix(const Histogram& histogram, const Eigen::Vector3f& goal, const Eigen::Vector3f& position,
+                        const Eigen::Vector3f& velocity, const costParameters& cost_params,
+                        const Eigen::Vector3f& closest_pt, const bool is_obstacle_facing_goal,
+                        Eigen::MatrixXf& distance_matrix, Eigen::MatrixXf& cost_matrix);
 
 /**
 * @brief      computes the cost of each direction in the polar histogram
@@ -117,9 +151,11 @@ std::pair<float, float> costFunction(const PolarPoint& candidate_polar, float ob
                                      const Eigen::Vector3f& closest_pt, const bool is_obstacle_facing_goal);
 
 /**
-* @brief      max-median filtes the cost matrix
+* @brief      smoothes the cost matrix with the conic kernel of getConicKernel,
+*             wrapping around elevation and azimuth. The cost per cell does not
+*             depend on the radius
 * @param      matrix, cost matrix
-* @param[in]  smoothing_radius, median filter window size
+* @param[in]  smoothing_radius, radius of the kernel
 **/
 void smoothPolarMatrix(Eigen::MatrixXf& matrix, unsigned int smoothing_radius);
 
@@ -0,0 +1,63 @@
+#ifndef LOCAL_PLANNER_POINTCLOUD_FUSION_H
+#define LOCAL_PLANNER_POINTCLOUD_FUSION_H
+
+#include "avoidance/common.h"
+#include "avoidance/fov_mask.h"
+#include "obstacle_memory.h"
+
+#include <local_planner/LocalPlannerNodeConfig.h>
+
+#include <Eigen/Dense>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <ros/time.h>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     first stage of the planner: fuses the camera clouds with the
+*            remembered obstacles into the binned cloud used for planning. It
+*            owns the obstacle memory, so it can run independently of the
+*            histogram and tree construction
+**/
+class PointcloudFusion {
+ private:
+  int min_num_points_per_cell_ = 3;
+
+  float min_sensor_range_ = 0.2f;
+  float max_sensor_range_ = 12.0f;
+  float max_point_age_s_ = 10;
+
+  ros::Time last_fusion_time_;
+  ObstacleMemory obstacle_memory_;
+  FOVMask fov_mask_;
+
+ public:
+  PointcloudFusion() = default;
+  ~PointcloudFusion() = default;
+
+  /**
+  * @brief     sets the fusion parameters from the ROS parameter server
+  * @param     config, struct containing all the parameters
+  **/
+  void dynamicReconfigureSetParams(const avoidance::LocalPlannerNodeConfig& config);
+
+  /**
+  * @brief     fuses the latest camera clouds with the obstacle memory
+  * @param[out] fused_cloud, binned cloud of current and remembered obstacles
+  * @param[in] clouds, latest cloud of each camera in the local origin frame
+  * @param[in] fov, field of view of each camera in the FCU frame
+  * @param[in] position, current vehicle position
+  * @param[in] yaw_fcu_frame_deg, current vehicle yaw in the FCU frame [deg]
+  * @param[in] pitch_fcu_frame_deg, current vehicle pitch in the FCU frame [deg]
+  **/
+  void fuse(pcl::PointCloud<pcl::PointXYZI>& fused_cloud, const std::vector<pcl::PointCloud<pcl::PointXYZ>>& clouds,
+            const std::vector<FOV>& fov, const Eigen::Vector3f& position, float yaw_fcu_frame_deg,
+            float pitch_fcu_frame_deg);
+};
+}
+
+#endif  // LOCAL_PLANNER_POINTCLOUD_FUSION_H
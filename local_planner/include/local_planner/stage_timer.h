@@ -0,0 +1,133 @@
+#ifndef LOCAL_PLANNER_STAGE_TIMER_H
+#define LOCAL_PLANNER_STAGE_TIMER_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     stages of the local planner pipeline, in processing order
+**/
+enum class PlannerStage {
+  cloud_receive,       ///< age of a pointcloud when it arrives at the planner
+  transform,           ///< conversion and transformation of a camera pointcloud
+  process_pointcloud,  ///< merge of the camera clouds with the obstacle memory
+  histogram,           ///< polar histogram construction
+  cost_matrix,         ///< cost matrix evaluation and smoothing
+  tree,                ///< look ahead tree search
+  waypoint,            ///< waypoint generation and setpoint publication
+  publish,             ///< publication of the planner outputs
+  count
+};
+
+/**
+* @brief     name of a pipeline stage
+* @param[in] stage, pipeline stage
+* @returns   lower case name of the stage
+**/
+const char* stageName(PlannerStage stage);
+
+/**
+* @brief     statistics over the recent durations of a pipeline stage
+**/
+struct StageStatistics {
+  size_t samples = 0;
+  float min_ms = 0.f;
+  float mean_ms = 0.f;
+  float p99_ms = 0.f;
+};
+
+/**
+* @brief     collects durations of the local planner pipeline stages over a
+*            rolling window of the latest samples. Measurements are only taken
+*            while the timer is enabled, a disabled timer does not read the
+*            clock. Samples can be added from any thread
+**/
+class StageTimer {
+ public:
+  typedef std::chrono::steady_clock Clock;
+  static constexpr size_t DEFAULT_WINDOW_SIZE = 128;
+
+  /**
+  * @brief     measures the lifetime of the object and adds it as a sample to
+  *            the stage it was created for
+  **/
+  class Scope {
+   public:
+    Scope(StageTimer& timer, PlannerStage stage);
+    Scope(Scope&& other);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    Scope& operator=(Scope&&) = delete;
+
+   private:
+    StageTimer* timer_;
+    PlannerStage stage_;
+    Clock::time_point start_;
+  };
+
+  explicit StageTimer(size_t window_size = DEFAULT_WINDOW_SIZE);
+  ~StageTimer() = default;
+
+  /**
+  * @brief     enables or disables the measurements. Enabling a disabled timer
+  *            discards the samples collected before it was disabled
+  * @param[in] enabled, true if the stages should be measured
+  **/
+  void setEnabled(bool enabled);
+  bool isEnabled() const { return enabled_; }
+
+  /**
+  * @brief     starts measuring a stage until the returned object goes out of
+  *            scope
+  * @param[in] stage, pipeline stage
+  **/
+  Scope measure(PlannerStage stage) { return Scope(*this, stage); }
+
+  /**
+  * @brief     adds a duration to the window of a stage, ignored while disabled
+  * @param[in] stage, pipeline stage
+  * @param[in] duration_ms, duration of the stage [ms]
+  **/
+  void addSample(PlannerStage stage, float duration_ms);
+
+  /**
+  * @brief     computes the statistics over the current window of a stage
+  * @param[in] stage, pipeline stage
+  * @returns   minimum, mean and 99th percentile of the recent samples
+  **/
+  StageStatistics getStatistics(PlannerStage stage) const;
+
+  /**
+  * @brief     discards all collected samples
+  **/
+  void reset();
+
+  /**
+  * @brief     changes the number of samples kept per stage, discards all
+  *            collected samples
+  * @param[in] window_size, number of latest samples the statistics cover
+  **/
+  void setWindowSize(size_t window_size);
+
+ private:
+  struct Window {
+    std::vector<float> samples;
+    size_t count = 0;
+    size_t next = 0;
+  };
+
+  std::atomic<bool> enabled_{false};
+  mutable std::mutex mutex_;
+  std::array<Window, static_cast<size_t>(PlannerStage::count)> windows_;
+};
+}
+
+#endif  // LOCAL_PLANNER_STAGE_TIMER_H
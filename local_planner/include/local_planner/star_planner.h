@@ -2,7 +2,11 @@
 #define STAR_PLANNER_H
 
 #include "avoidance/histogram.h"
+#include "candidate_direction.h"
 #include "cost_parameters.h"
+#include "indexed_min_heap.h"
+#include "voxel_index.h"
+#include "worker_pool.h"
 
 #include <Eigen/Dense>
 
@@ -14,6 +18,8 @@
 #include <dynamic_reconfigure/server.h>
 #include <local_planner/LocalPlannerNodeConfig.h>
 
+#include <memory>
+#include <unordered_map>
 #include <vector>
 
 namespace avoidance {
@@ -21,6 +27,7 @@ class TreeNode;
 
 class StarPlanner {
   int children_per_node_ = 1;
+  float children_min_angle_deg_ = 0.f;
   int n_expanded_nodes_ = 5;
   float tree_node_distance_ = 1.0f;
   float max_path_length_ = 4.f;
@@ -28,15 +35,101 @@ class StarPlanner {
   float tree_heuristic_weight_ = 10.0f;
   float max_sensor_range_ = 15.f;
   float min_sensor_range_ = 0.2f;
+  int expansion_batch_size_ = 1;
+  float min_node_distance_ = 0.2f;
+  bool reuse_tree_ = false;
+  float tree_time_budget_ms_ = 0.f;
+  bool tree_reusable_ = false;
 
-  pcl::PointCloud<pcl::PointXYZI> cloud_;
+  // the planning cloud, indexed once per cycle so that node histograms only visit points in range
+  VoxelIndex cloud_index_;
 
   Eigen::Vector3f goal_ = Eigen::Vector3f(NAN, NAN, NAN);
   Eigen::Vector3f position_ = Eigen::Vector3f(NAN, NAN, NAN);
   Eigen::Vector3f velocity_ = Eigen::Vector3f(NAN, NAN, NAN);
   Eigen::Vector3f closest_pt_ = Eigen::Vector3f(NAN, NAN, NAN);
+  Eigen::Vector3f tree_goal_ = Eigen::Vector3f(NAN, NAN, NAN);
+
+  // statistics of the last tree
+  int expanded_nodes_ = 0;
+  float time_slack_ms_ = NAN;
   costParameters cost_params_;
 
+  /**
+  * @brief     memory used by one worker to expand a node, reused across nodes
+  **/
+  struct ExpansionScratch {
+    Histogram histogram;
+    pcl::PointCloud<pcl::PointXYZI> node_cloud;
+    Eigen::MatrixXf cost_matrix;
+    std::vector<uint8_t> cost_image_data;  // stays empty, node expansions do not generate images
+
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+  };
+
+  std::unique_ptr<WorkerPool> worker_pool_;
+  std::vector<ExpansionScratch, Eigen::aligned_allocator<ExpansionScratch>> scratch_;
+  std::vector<std::vector<candidateDirection>> batch_candidates_;
+
+  // open nodes within max_path_length_ ordered by total cost
+  IndexedMinHeap open_set_;
+  // tree nodes hashed into voxels of min_node_distance_ to reject close candidates
+  std::unordered_map<int64_t, std::vector<int>> node_grid_;
+
+  /**
+  * @brief     computes the best candidate directions from a tree node. Only
+  *            reads the tree, so several nodes can be expanded concurrently
+  * @param[in] node_number, sequential number of entry in the tree
+  * @param     scratch, working memory of the calling worker
+  * @param[out] candidates, best children_per_node_ directions, lowest cost first
+  **/
+  void computeNodeCandidates(int node_number, ExpansionScratch& scratch,
+                             std::vector<candidateDirection>& candidates) const;
+
+  /**
+  * @brief     takes the open nodes to expand next from the open set
+  * @param[in] max_nodes, maximum number of nodes to select
+  * @param[out] batch, the cheapest open nodes within max_path_length_,
+  *            cheapest first
+  **/
+  void selectNodesToExpand(int max_nodes, std::vector<int>& batch);
+
+  /**
+  * @brief     registers a tree node in the node grid and, if it can be
+  *            expanded, in the open set
+  * @param[in] node_number, sequential number of entry in the tree
+  **/
+  void registerTreeNode(int node_number);
+
+  /**
+  * @brief     checks whether a tree node lies closer than min_node_distance_
+  * @param[in] position, candidate node position
+  * @returns   true if the candidate is too close to an existing node
+  **/
+  bool isCloseToTreeNode(const Eigen::Vector3f& position) const;
+
+  /**
+  * @brief     checks an edge of the tree against the current pointcloud. The
+  *            edge is blocked if a point lies in the histogram bin it passes
+  *            through, closer than the end of the edge
+  * @param[in] from, position of the parent node
+  * @param[in] to, position of the child node
+  * @param     scratch, storage for the points around the parent node
+  * @returns   true if the edge is blocked
+  **/
+  bool isEdgeBlocked(const Eigen::Vector3f& from, const Eigen::Vector3f& to,
+                     pcl::PointCloud<pcl::PointXYZI>& scratch) const;
+
+  /**
+  * @brief     re-roots the tree of the previous cycle at the node closest to
+  *            the vehicle. Branches blocked by the current pointcloud are
+  *            removed and their parents reopened, so only these and the
+  *            frontier nodes need to be expanded again
+  * @returns   true if the previous tree could be reused, otherwise the tree
+  *            is left untouched
+  **/
+  bool reusePreviousTree();
+
  protected:
   /**
   * @brief     computes the heuristic for a node
@@ -60,7 +153,8 @@ class StarPlanner {
   void setParams(costParameters cost_params);
 
   /**
-  * @brief     setter method for star_planner pointcloud
+  * @brief     setter method for star_planner pointcloud, builds the spatial
+  *            index used for the histograms of the tree nodes
   * @param[in] cloud, processed data already cropped and combined with history
   **/
   void setPointcloud(const pcl::PointCloud<pcl::PointXYZI>& cloud);
@@ -84,10 +178,26 @@ class StarPlanner {
   void setGoal(const Eigen::Vector3f& pose);
 
   /**
-  * @brief     build tree of candidates directions towards the goal
+  * @brief     build tree of candidates directions towards the goal. With a
+  *            time budget set, expansion stops before the next batch of nodes
+  *            would exceed it and the best path found so far is used
   **/
   void buildLookAheadTree();
 
+  /**
+  * @brief     getter method for the number of nodes expanded in the last tree
+  * @returns   expansions of the last call to buildLookAheadTree, reused nodes
+  *            are not counted
+  **/
+  int getExpandedNodes() const { return expanded_nodes_; }
+
+  /**
+  * @brief     getter method for the time left of the tree time budget
+  * @returns   budget minus the time taken by the last tree [ms], negative if
+  *            it was exceeded, NAN without budget
+  **/
+  float getTimeSlack() const { return time_slack_ms_; }
+
   /**
   * @brief     setter method for server paramters
   **/
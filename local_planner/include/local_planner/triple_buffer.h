@@ -0,0 +1,74 @@
+#ifndef LOCAL_PLANNER_TRIPLE_BUFFER_H
+#define LOCAL_PLANNER_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace avoidance {
+
+/**
+* @brief     lock-free handoff of the latest value from one producer thread to
+*            one consumer thread. The producer fills its own slot and
+*            publishes it by swapping it with the shared middle slot, the
+*            consumer swaps its own slot with the middle one when new data is
+*            available. Neither side ever waits for the other, unread values
+*            are overwritten, so the consumer always gets the freshest
+*            published value. Slots are recycled, which lets containers keep
+*            their storage
+**/
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() : write_{0}, middle_{1}, read_{2} {}
+  ~TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  /**
+  * @brief     slot owned by the producer, only to be used by the producer
+  *            thread. Its content is arbitrary old data
+  **/
+  T& write() { return buffers_[write_]; }
+
+  /**
+  * @brief     hands the producer slot over to the consumer, called by the
+  *            producer thread after filling write()
+  **/
+  void publish() { write_ = middle_.exchange(write_ | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK; }
+
+  /**
+  * @brief     checks for a value published since the last update
+  **/
+  bool hasNewData() const { return middle_.load(std::memory_order_acquire) & NEW_DATA; }
+
+  /**
+  * @brief     makes the latest published value available in read(), only to
+  *            be called by the consumer thread
+  * @returns   true if there was a new value, otherwise read() is unchanged
+  **/
+  bool update() {
+    if (!hasNewData()) return false;
+    read_ = middle_.exchange(read_, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+
+  /**
+  * @brief     slot owned by the consumer, only to be used by the consumer
+  *            thread. Holds the value picked up by the last update
+  **/
+  T& read() { return buffers_[read_]; }
+
+ private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t NEW_DATA = 0x4;
+
+  std::array<T, 3> buffers_;
+  uint8_t write_;
+  std::atomic<uint8_t> middle_;
+  uint8_t read_;
+};
+}
+
+#endif  // LOCAL_PLANNER_TRIPLE_BUFFER_H
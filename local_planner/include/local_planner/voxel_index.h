@@ -0,0 +1,72 @@
+#ifndef LOCAL_PLANNER_VOXEL_INDEX_H
+#define LOCAL_PLANNER_VOXEL_INDEX_H
+
+#include <Eigen/Core>
+
+#include <pcl/point_cloud.h>
+#include <pcl/point_types.h>
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+
+namespace avoidance {
+
+/**
+* @brief     computes the integer coordinates of the voxel containing a point
+* @param[in] point, 3D position [m]
+* @param[in] voxel_size, edge length of the voxels [m]
+**/
+inline Eigen::Vector3i voxelCoordinates(const Eigen::Vector3f& point, float voxel_size) {
+  return (point / voxel_size).array().floor().cast<int>();
+}
+
+/**
+* @brief     packs voxel coordinates into a hash key, 21 bits per axis
+* @param[in] voxel, integer voxel coordinates
+**/
+inline int64_t voxelKey(const Eigen::Vector3i& voxel) {
+  // offset so that negative voxel coordinates stay positive
+  const int64_t offset = 1 << 20;
+  const int64_t mask = (1 << 21) - 1;
+  return (((voxel.x() + offset) & mask) << 42) | (((voxel.y() + offset) & mask) << 21) | ((voxel.z() + offset) & mask);
+}
+
+/**
+* @brief     uniform voxel hash over a pointcloud. The points are stored
+*            grouped by voxel, so a radius query only visits the voxels
+*            overlapping the query sphere and copies whole voxels which lie
+*            completely inside it without testing their points
+**/
+class VoxelIndex {
+  float voxel_size_ = 1.f;
+
+  // points sorted by voxel, each voxel maps to its [begin, end) range
+  pcl::PointCloud<pcl::PointXYZI> points_;
+  std::unordered_map<int64_t, std::pair<size_t, size_t>> voxels_;
+
+ public:
+  VoxelIndex() = default;
+  ~VoxelIndex() = default;
+
+  /**
+  * @brief     rebuilds the index, previous content is discarded
+  * @param[in] cloud, points to index
+  * @param[in] voxel_size, edge length of the voxels [m]
+  **/
+  void build(const pcl::PointCloud<pcl::PointXYZI>& cloud, float voxel_size);
+
+  /**
+  * @brief     collects all indexed points within a sphere
+  * @param[in] center, center of the sphere
+  * @param[in] radius, radius of the sphere [m]
+  * @param[out] result, points within radius of center, the storage is reused
+  *            between calls
+  **/
+  void radiusSearch(const Eigen::Vector3f& center, float radius, pcl::PointCloud<pcl::PointXYZI>& result) const;
+
+  size_t size() const { return points_.points.size(); }
+};
+}
+
+#endif  // LOCAL_PLANNER_VOXEL_INDEX_H
@@ -0,0 +1,64 @@
+#ifndef LOCAL_PLANNER_WORKER_POOL_H
+#define LOCAL_PLANNER_WORKER_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace avoidance {
+
+/**
+* @brief     fixed pool of worker threads executing parallel for loops. The
+*            calling thread takes part in the work, so a pool of size n starts
+*            n - 1 threads
+**/
+class WorkerPool {
+ public:
+  typedef std::function<void(size_t task, size_t worker)> Task;
+
+  /**
+  * @param[in] num_workers, total number of workers including the caller
+  **/
+  explicit WorkerPool(size_t num_workers = 1);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  /**
+  * @brief     number of workers including the calling thread
+  **/
+  size_t size() const { return threads_.size() + 1; }
+
+  /**
+  * @brief     runs task(i, worker) for every i in [0, num_tasks) and returns
+  *            once all of them are done
+  * @param[in] num_tasks, number of tasks
+  * @param[in] task, callable which is given the task index and the index of
+  *            the worker in [0, size()) executing it, so per worker scratch
+  *            memory can be used without locking
+  **/
+  void run(size_t num_tasks, const Task& task);
+
+ private:
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+
+  const Task* task_ = nullptr;
+  size_t num_tasks_ = 0;
+  std::atomic<size_t> next_task_{0};
+  size_t generation_ = 0;
+  size_t busy_workers_ = 0;
+  bool should_exit_ = false;
+
+  void workerThread(size_t worker);
+  void executeTasks(size_t worker);
+};
+}
+
+#endif  // LOCAL_PLANNER_WORKER_POOL_H
@@ -28,8 +28,6 @@ void LocalPlanner::dynamicReconfigureSetParams(avoidance::LocalPlannerNodeConfig
   cost_params_.yaw_cost_param = config.yaw_cost_param_;
   cost_params_.velocity_cost_param = config.velocity_cost_param_;
   cost_params_.obstacle_cost_param = config.obstacle_cost_param_;
-  max_point_age_s_ = static_cast<float>(config.max_point_age_s_);
-  min_num_points_per_cell_ = config.min_num_points_per_cell_;
   min_sensor_range_ = static_cast<float>(config.min_sensor_range_);
   timeout_startup_ = config.timeout_startup_;
   timeout_critical_ = config.timeout_critical_;
@@ -37,6 +35,7 @@ void LocalPlanner::dynamicReconfigureSetParams(avoidance::LocalPlannerNodeConfig
   children_per_node_ = config.children_per_node_;
   n_expanded_nodes_ = config.n_expanded_nodes_;
   smoothing_margin_degrees_ = static_cast<float>(config.smoothing_margin_degrees_);
+  fusion_.dynamicReconfigureSetParams(config);
 
   if (getGoal().z() != config.goal_z_param) {
     auto goal = getGoal();
@@ -73,12 +72,17 @@ void LocalPlanner::runPlanner() {
   ROS_INFO("\033[1;35m[OA] Planning started, using %i cameras\n \033[0m",
            static_cast<int>(original_cloud_vector_.size()));
 
-  float elapsed_since_last_processing = static_cast<float>((ros::Time::now() - last_pointcloud_process_time_).toSec());
-  processPointcloud(final_cloud_, original_cloud_vector_, fov_fcu_frame_, yaw_fcu_frame_deg_, pitch_fcu_frame_deg_,
-                    position_, min_sensor_range_, max_sensor_range_, max_point_age_s_, elapsed_since_last_processing,
-                    min_num_points_per_cell_);
-  last_pointcloud_process_time_ = ros::Time::now();
+  {
+    auto timing = stage_timer_.measure(PlannerStage::process_pointcloud);
+    fusion_.fuse(final_cloud_, original_cloud_vector_, fov_fcu_frame_, position_, yaw_fcu_frame_deg_,
+                 pitch_fcu_frame_deg_);
+  }
+
+  determineStrategy();
+}
 
+void LocalPlanner::runPlanner(pcl::PointCloud<pcl::PointXYZI>& fused_cloud) {
+  final_cloud_.swap(fused_cloud);
   determineStrategy();
 }
 
@@ -96,7 +100,11 @@ void LocalPlanner::create2DObstacleRepresentation(const bool send_to_fcu) {
   polar_histogram_ = new_histogram;
 
   // generate histogram image for logging
-  generateHistogramImage(polar_histogram_);
+  if (generate_histogram_image_) {
+    generateHistogramImage(polar_histogram_);
+  } else {
+    histogram_image_data_.clear();
+  }
 }
 
 void LocalPlanner::generateHistogramImage(Histogram& histogram) {
@@ -116,9 +124,14 @@ void LocalPlanner::generateHistogramImage(Histogram& histogram) {
 void LocalPlanner::determineStrategy() {
   // clear cost image
   cost_image_data_.clear();
-  cost_image_data_.resize(3 * GRID_LENGTH_E * GRID_LENGTH_Z, 0);
+  if (generate_cost_image_) {
+    cost_image_data_.resize(3 * GRID_LENGTH_E * GRID_LENGTH_Z, 0);
+  }
 
-  create2DObstacleRepresentation(px4_.param_cp_dist > 0.f);
+  {
+    auto timing = stage_timer_.measure(PlannerStage::histogram);
+    create2DObstacleRepresentation(px4_.param_cp_dist > 0.f);
+  }
 
   // calculate the vehicle projected position on the line between the previous and current goal
   Eigen::Vector2f u_prev_to_goal = (goal_ - prev_goal_).head<2>().normalized();
@@ -134,20 +147,24 @@ void LocalPlanner::determineStrategy() {
   }
 
   if (!polar_histogram_.isEmpty()) {
-    getCostMatrix(polar_histogram_, goal_, position_, velocity_, cost_params_, smoothing_margin_degrees_, closest_pt_,
-                  max_sensor_range_, min_sensor_range_, cost_matrix_, cost_image_data_);
+    {
+      auto timing = stage_timer_.measure(PlannerStage::cost_matrix);
+      getCostMatrix(polar_histogram_, goal_, position_, velocity_, cost_params_, smoothing_margin_degrees_,
+                    closest_pt_, max_sensor_range_, min_sensor_range_, cost_matrix_, cost_image_data_,
+                    generate_cost_image_);
+    }
 
+    // build search tree
+    auto timing = stage_timer_.measure(PlannerStage::tree);
     star_planner_->setParams(cost_params_);
     star_planner_->setPointcloud(final_cloud_);
     star_planner_->setClosestPointOnLine(closest_pt_);
-
-    // build search tree
     star_planner_->buildLookAheadTree();
     last_path_time_ = ros::Time::now();
   }
 }
 
-void LocalPlanner::updateObstacleDistanceMsg(Histogram hist) {
+void LocalPlanner::updateObstacleDistanceMsg(const Histogram& hist) {
   sensor_msgs::LaserScan msg = {};
   msg.header.stamp = ros::Time::now();
   msg.header.frame_id = "local_origin";
@@ -232,6 +249,8 @@ avoidanceOutput LocalPlanner::getAvoidanceOutput() const {
 
   out.cruise_velocity = max_speed;
   out.last_path_time = last_path_time_;
+  out.tree_expanded_nodes = star_planner_->getExpandedNodes();
+  out.tree_time_slack_ms = star_planner_->getTimeSlack();
 
   out.path_node_positions = star_planner_->path_node_positions_;
   return out;
@@ -5,6 +5,7 @@
 #include "local_planner/tree_node.h"
 #include "local_planner/waypoint_generator.h"
 
+#include <tf2/exceptions.h>
 #include <boost/algorithm/string.hpp>
 
 #include <atomic>
@@ -15,19 +16,16 @@
 
 namespace avoidance {
 
-LocalPlannerNodelet::LocalPlannerNodelet() : tf_buffer_(5.f), spin_dt_(0.1) {}
+LocalPlannerNodelet::LocalPlannerNodelet() : tf_buffer_(5.f), tf_tree_(ros::Duration(5.0)), spin_dt_(0.1) {}
 
 LocalPlannerNodelet::~LocalPlannerNodelet() {
   should_exit_ = true;
-  {
-    std::lock_guard<std::mutex> guard(buffered_transforms_mutex_);
-    tf_buffer_cv_.notify_all();
-  }
-
   {
     std::lock_guard<std::mutex> guard(transformed_cloud_mutex_);
     transformed_cloud_cv_.notify_all();
   }
+  fused_frames_.close();
+  planned_frames_.close();
 
   for (size_t i = 0; i < cameras_.size(); ++i) {
     {
@@ -38,6 +36,8 @@ LocalPlannerNodelet::~LocalPlannerNodelet() {
   }
 
   if (worker.joinable()) worker.join();
+  if (worker_planning.joinable()) worker_planning.join();
+  if (worker_publishing.joinable()) worker_publishing.join();
   if (worker_tf_listener.joinable()) worker_tf_listener.join();
 
   if (server_ != nullptr) delete server_;
@@ -51,7 +51,11 @@ void LocalPlannerNodelet::onInit() {
   startNode();
 
   worker = std::thread(&LocalPlannerNodelet::threadFunction, this);
-  worker_tf_listener = std::thread(&LocalPlannerNodelet::transformBufferThread, this);
+  worker_planning = std::thread(&LocalPlannerNodelet::planningThread, this);
+  worker_publishing = std::thread(&LocalPlannerNodelet::publishingThread, this);
+  if (!event_driven_tf_) {
+    worker_tf_listener = std::thread(&LocalPlannerNodelet::transformBufferThread, this);
+  }
   // Set up Dynamic Reconfigure Server
   server_ = new dynamic_reconfigure::Server<avoidance::LocalPlannerNodeConfig>(config_mutex_, getPrivateNodeHandle());
   dynamic_reconfigure::Server<avoidance::LocalPlannerNodeConfig>::CallbackType f;
@@ -65,6 +69,7 @@ void LocalPlannerNodelet::InitializeNodelet() {
 
   local_planner_.reset(new LocalPlanner());
   wp_generator_.reset(new WaypointGenerator());
+  max_sensor_range_ = local_planner_->getSensorRange();
   avoidance_node_.reset(new AvoidanceNode(nh_, nh_private_));
 
 #ifndef DISABLE_SIMULATION
@@ -73,7 +78,15 @@ void LocalPlannerNodelet::InitializeNodelet() {
 
   readParams();
 
-  tf_listener_ = new tf::TransformListener(ros::Duration(tf::Transformer::DEFAULT_CACHE_TIME), true);
+  if (event_driven_tf_) {
+    // the transforms are inserted with their own stamps as they arrive, the static ones are latched
+    tf_sub_ = nh_.subscribe<tf2_msgs::TFMessage>("/tf", 100,
+                                                 boost::bind(&LocalPlannerNodelet::tfCallback, this, _1, false));
+    tf_static_sub_ = nh_.subscribe<tf2_msgs::TFMessage>("/tf_static", 100,
+                                                        boost::bind(&LocalPlannerNodelet::tfCallback, this, _1, true));
+  } else {
+    tf_listener_ = new tf::TransformListener(ros::Duration(tf::Transformer::DEFAULT_CACHE_TIME), true);
+  }
 
   // initialize standard subscribers
   pose_sub_ = nh_.subscribe<const geometry_msgs::PoseStamped&>("/mavros/local_position/pose", 1,
@@ -90,6 +103,7 @@ void LocalPlannerNodelet::InitializeNodelet() {
   mavros_pos_setpoint_pub_ = nh_.advertise<geometry_msgs::PoseStamped>("/mavros/setpoint_position/local", 10);
   mavros_obstacle_free_path_pub_ = nh_.advertise<mavros_msgs::Trajectory>("/mavros/trajectory/generated", 10);
   mavros_obstacle_distance_pub_ = nh_.advertise<sensor_msgs::LaserScan>("/mavros/obstacle/send", 10);
+  stage_timing_pub_ = nh_.advertise<std_msgs::Float32MultiArray>("/planner_stage_timing", 1);
 
   // initialize visualization topics
   visualizer_.initializePublishers(nh_);
@@ -123,6 +137,7 @@ void LocalPlannerNodelet::readParams() {
   nh_private_.param<double>(nodelet::Nodelet::getName() + "/goal_y_param", goal_d.y(), 0.0);
   nh_private_.param<double>(nodelet::Nodelet::getName() + "/lgoal_z_param", goal_d.z(), 0.0);
   nh_private_.param<bool>(nodelet::Nodelet::getName() + "/accept_goal_input_topic", accept_goal_input_topic_, false);
+  nh_private_.param<bool>(nodelet::Nodelet::getName() + "/event_driven_tf", event_driven_tf_, false);
   goal_position_ = goal_d.cast<float>();
 
   std::vector<std::string> camera_topics;
@@ -137,10 +152,10 @@ void LocalPlannerNodelet::initializeCameraSubscribers(std::vector<std::string>&
   cameras_.resize(camera_topics.size());
 
   for (size_t i = 0; i < camera_topics.size(); i++) {
+    cameras_[i].received_cloud_.reset(new TripleBuffer<sensor_msgs::PointCloud2::ConstPtr>);
+    cameras_[i].transformed_frame_.reset(new TripleBuffer<transformedFrame>);
     cameras_[i].camera_mutex_.reset(new std::mutex);
     cameras_[i].camera_cv_.reset(new std::condition_variable);
-
-    cameras_[i].received_ = false;
     cameras_[i].transformed_ = false;
 
     cameras_[i].pointcloud_sub_ = nh_.subscribe<sensor_msgs::PointCloud2>(
@@ -153,30 +168,67 @@ void LocalPlannerNodelet::initializeCameraSubscribers(std::vector<std::string>&
 size_t LocalPlannerNodelet::numTransformedClouds() {
   size_t num_transformed_clouds = 0;
   for (size_t i = 0; i < cameras_.size(); i++) {
-    std::lock_guard<std::mutex> transformed_cloud_guard(*(cameras_[i].camera_mutex_));
+    if (cameras_[i].transformed_frame_->update()) cameras_[i].transformed_ = true;
     if (cameras_[i].transformed_) num_transformed_clouds++;
   }
   return num_transformed_clouds;
 }
 
-void LocalPlannerNodelet::updatePlannerInfo() {
-  // update the point cloud
-  local_planner_->original_cloud_vector_.resize(cameras_.size());
+bool LocalPlannerNodelet::camerasReady() {
+  size_t num_transformed_clouds = numTransformedClouds();
+  if (plan_on_any_camera_) {
+    return num_transformed_clouds > 0;
+  }
+  return cameras_.size() > 0 && num_transformed_clouds == cameras_.size();
+}
+
+size_t LocalPlannerNodelet::takeTransformedFrames(std::vector<pcl::PointCloud<pcl::PointXYZ>>& clouds,
+                                                  std::vector<FOV>& fusion_fov, std::vector<FOV>& fov) {
+  clouds.resize(cameras_.size());
+  fusion_fov.resize(cameras_.size());
+  fov.resize(cameras_.size());
+  const ros::Time now = ros::Time::now();
+  size_t num_new_frames = 0;
   for (size_t i = 0; i < cameras_.size(); ++i) {
-    std::lock_guard<std::mutex> transformed_cloud_guard(*(cameras_[i].camera_mutex_));
-    try {
-      std::swap(local_planner_->original_cloud_vector_[i], cameras_[i].transformed_cloud_);
-      cameras_[i].transformed_cloud_.clear();
-      cameras_[i].transformed_ = false;
-      local_planner_->setFOV(i, cameras_[i].fov_fcu_frame_);
-      wp_generator_->setFOV(i, cameras_[i].fov_fcu_frame_);
-    } catch (tf::TransformException& ex) {
-      ROS_ERROR("Received an exception trying to transform a pointcloud: %s", ex.what());
+    cameraData& camera = cameras_[i];
+    // take a frame completed since the wait ended, the consumed slot storage is recycled by the transform thread
+    if (camera.transformed_frame_->update()) camera.transformed_ = true;
+    transformedFrame& frame = camera.transformed_frame_->read();
+    clouds[i].clear();
+    clouds[i].header = pcl::PCLHeader();
+    fusion_fov[i] = FOV();
+    fov[i] = FOV();
+    if (camera.transformed_) {
+      std::swap(clouds[i], frame.cloud);
+      frame.cloud.clear();
+      camera.transformed_ = false;
+      camera.frame_stamp_ = pcl_conversions::fromPCL(clouds[i].header.stamp);
+      fusion_fov[i] = frame.fov_fcu_frame;
+      fov[i] = frame.fov_fcu_frame;
+      num_new_frames++;
+    } else if (!camera.frame_stamp_.isZero()) {
+      // the memory keeps the obstacles of a camera without a new frame, but its view is only trusted for a while
+      float staleness_s = static_cast<float>((now - camera.frame_stamp_).toSec());
+      if (staleness_s <= max_camera_staleness_s_) {
+        fov[i] = frame.fov_fcu_frame;
+      } else {
+        ROS_WARN_THROTTLE(5.0, "[OA] No new pointcloud on %s for %.1fs, treating its field of view as unobserved",
+                          camera.topic_.c_str(), staleness_s);
+      }
     }
   }
+  return num_new_frames;
+}
+
+void LocalPlannerNodelet::updatePlannerInfo(const fusedFrame& frame) {
+  // update the FOV
+  for (size_t i = 0; i < frame.fov_fcu_frame.size(); ++i) {
+    local_planner_->setFOV(i, frame.fov_fcu_frame[i]);
+    wp_generator_->setFOV(i, frame.fov_fcu_frame[i]);
+  }
 
   // update pose
-  local_planner_->setState(newest_position_, velocity_, newest_orientation_);
+  local_planner_->setState(frame.position, frame.velocity, frame.orientation);
 
   // update state
   local_planner_->currently_armed_ = armed_;
@@ -268,6 +320,7 @@ void LocalPlannerNodelet::cmdLoopCallback(const ros::TimerEvent& event) {
 
   // send waypoint
   if (avoidance_node_->getSystemStatus() == MAV_STATE::MAV_STATE_ACTIVE) {
+    auto timing = local_planner_->getStageTimer().measure(PlannerStage::waypoint);
     calculateWaypoints(hover_);
   }
 
@@ -371,24 +424,71 @@ void LocalPlannerNodelet::transformBufferThread() {
   while (!should_exit_) {
     {
       std::lock_guard<std::mutex> guard(buffered_transforms_mutex_);
-      for (auto const& frame_pair : buffered_transforms_) {
+      bool inserted = false;
+      for (auto& frame_pair : buffered_transforms_) {
         tf::StampedTransform transform;
 
-        if (tf_listener_->canTransform(frame_pair.second, frame_pair.first, ros::Time(0))) {
+        if (tf_listener_->canTransform(frame_pair.target_frame, frame_pair.source_frame, ros::Time(0))) {
           try {
-            tf_listener_->lookupTransform(frame_pair.second, frame_pair.first, ros::Time(0), transform);
-            tf_buffer_.insertTransform(frame_pair.first, frame_pair.second, transform);
+            tf_listener_->lookupTransform(frame_pair.target_frame, frame_pair.source_frame, ros::Time(0), transform);
+            if (frame_pair.insert(tf_buffer_, transform)) inserted = true;
           } catch (tf::TransformException& ex) {
             ROS_ERROR("Received an exception trying to get transform: %s", ex.what());
           }
         }
       }
-      tf_buffer_cv_.notify_all();
+      if (inserted) notifyTransformWaiters();
     }
     std::this_thread::sleep_for(std::chrono::milliseconds(5));
   }
 }
 
+void LocalPlannerNodelet::tfCallback(const tf2_msgs::TFMessage::ConstPtr& msg, bool is_static) {
+  std::lock_guard<std::mutex> guard(buffered_transforms_mutex_);
+  for (geometry_msgs::TransformStamped transform : msg->transforms) {
+    // tf2 does not accept frame ids with a leading slash
+    transform.header.frame_id = tf::strip_leading_slash(transform.header.frame_id);
+    transform.child_frame_id = tf::strip_leading_slash(transform.child_frame_id);
+    tf_tree_.setTransform(transform, "tf", is_static);
+  }
+
+  bool inserted = false;
+  for (auto& frame_pair : buffered_transforms_) {
+    const std::string target_frame = tf::strip_leading_slash(frame_pair.target_frame);
+    const std::string source_frame = tf::strip_leading_slash(frame_pair.source_frame);
+    // time zero resolves to the latest time the whole chain is known at, which is the stamp of an actual sample
+    // instead of a copy of the newest transform restamped at the polling time
+    if (!tf_tree_.canTransform(target_frame, source_frame, ros::Time(0))) continue;
+    try {
+      tf::StampedTransform transform;
+      tf::transformStampedMsgToTF(tf_tree_.lookupTransform(target_frame, source_frame, ros::Time(0)), transform);
+      if (frame_pair.insert(tf_buffer_, transform)) inserted = true;
+    } catch (tf2::TransformException& ex) {
+      ROS_ERROR("Received an exception trying to get transform: %s", ex.what());
+    }
+  }
+  if (inserted) notifyTransformWaiters();
+}
+
+void LocalPlannerNodelet::notifyTransformWaiters() {
+  for (cameraData& camera : cameras_) {
+    std::lock_guard<std::mutex> lck(*(camera.camera_mutex_));
+    if (camera.transform_wait_stamp_.isZero()) continue;
+
+    // the cloud can be transformed once every frame pair of its frame reaches its stamp
+    bool covered = false;
+    for (const auto& frame_pair : buffered_transforms_) {
+      if (frame_pair.source_frame != camera.transform_wait_frame_) continue;
+      covered = frame_pair.covers(camera.transform_wait_stamp_);
+      if (!covered) break;
+    }
+    if (covered) {
+      camera.transform_wait_stamp_ = ros::Time();
+      camera.camera_cv_->notify_all();
+    }
+  }
+}
+
 void LocalPlannerNodelet::printPointInfo(double x, double y, double z) {
   Eigen::Vector3f drone_pos = local_planner_->getPosition();
   int beta_z = floor((atan2(x - drone_pos.x(), y - drone_pos.y()) * 180.0 / M_PI));  //(-180. +180]
@@ -404,30 +504,30 @@ void LocalPlannerNodelet::printPointInfo(double x, double y, double z) {
 }
 
 void LocalPlannerNodelet::pointCloudCallback(const sensor_msgs::PointCloud2::ConstPtr& msg, int index) {
-  std::lock_guard<std::mutex> lck(*(cameras_[index].camera_mutex_));
-
-  auto timeSinceLast = [&]() -> ros::Duration {
-    ros::Time lastCloudReceived = pcl_conversions::fromPCL(cameras_[index].untransformed_cloud_.header.stamp);
-    return msg->header.stamp - lastCloudReceived;
-  };
-
-  if (cameras_[index].received_ && timeSinceLast() < ros::Duration(0.3)) {
-    return;
+  // sensor to planner latency, based on the ROS clock since the stamp was taken by the sensor driver
+  StageTimer& stage_timer = local_planner_->getStageTimer();
+  if (stage_timer.isEnabled()) {
+    stage_timer.addSample(PlannerStage::cloud_receive, 1000.f * (ros::Time::now() - msg->header.stamp).toSec());
   }
 
-  pcl::fromROSMsg(*msg, cameras_[index].untransformed_cloud_);
-  cameras_[index].received_ = true;
-  cameras_[index].camera_cv_->notify_all();
+  // keep a reference to the message, the points are read from its buffer by the transform thread
+  cameras_[index].received_cloud_->write() = msg;
+  cameras_[index].received_cloud_->publish();
+  {
+    std::lock_guard<std::mutex> lck(*(cameras_[index].camera_mutex_));
+    cameras_[index].camera_cv_->notify_all();
+  }
 
   // this runs once at the beginning to get the transforms
   if (!cameras_[index].transform_registered_) {
     std::lock_guard<std::mutex> tf_list_guard(buffered_transforms_mutex_);
-    std::pair<std::string, std::string> transform_frames;
-    transform_frames.first = msg->header.frame_id;
-    transform_frames.second = "/local_origin";
-    buffered_transforms_.push_back(transform_frames);
-    transform_frames.second = "/fcu";
-    buffered_transforms_.push_back(transform_frames);
+    for (const std::string& target_frame : {"/local_origin", "/fcu"}) {
+      bufferedFramePair frame_pair;
+      frame_pair.source_frame = msg->header.frame_id;
+      frame_pair.target_frame = target_frame;
+      frame_pair.handle = tf_buffer_.getFramePairHandle(frame_pair.source_frame, frame_pair.target_frame);
+      buffered_transforms_.push_back(frame_pair);
+    }
     cameras_[index].transform_registered_ = true;
   }
 }
@@ -435,20 +535,23 @@ void LocalPlannerNodelet::pointCloudCallback(const sensor_msgs::PointCloud2::Con
 void LocalPlannerNodelet::dynamicReconfigureCallback(avoidance::LocalPlannerNodeConfig& config, uint32_t level) {
   std::lock_guard<std::mutex> guard(running_mutex_);
   local_planner_->dynamicReconfigureSetParams(config, level);
+  {
+    std::lock_guard<std::mutex> fusion_guard(fusion_mutex_);
+    fusion_.dynamicReconfigureSetParams(config);
+  }
+  plan_on_any_camera_ = config.plan_on_any_camera_;
+  max_camera_staleness_s_ = static_cast<float>(config.max_camera_staleness_s_);
+  deskew_scan_time_s_ = static_cast<float>(config.deskew_scan_time_s_);
+  deskew_slices_ = config.deskew_slices_;
+  max_sensor_range_ = static_cast<float>(config.max_sensor_range_);
   wp_generator_->setSmoothingSpeed(config.smoothing_speed_xy_, config.smoothing_speed_z_);
   rqt_param_config_ = config;
 }
 
-void LocalPlannerNodelet::publishLaserScan() const {
-  // inverted logic to make sure values like NAN default to sending the message
-  if (!(local_planner_->px4_.param_cp_dist < 0)) {
-    sensor_msgs::LaserScan distance_data_to_fcu;
-    local_planner_->getObstacleDistanceData(distance_data_to_fcu);
-
-    // only send message if planner had a chance to fill it with valid data
-    if (distance_data_to_fcu.angle_increment > 0.f) {
-      mavros_obstacle_distance_pub_.publish(distance_data_to_fcu);
-    }
+void LocalPlannerNodelet::publishLaserScan(const sensor_msgs::LaserScan& obstacle_distance) const {
+  // only send message if planner had a chance to fill it with valid data
+  if (obstacle_distance.angle_increment > 0.f) {
+    mavros_obstacle_distance_pub_.publish(obstacle_distance);
   }
 }
 
@@ -456,35 +559,115 @@ void LocalPlannerNodelet::threadFunction() {
   while (!should_exit_) {
     ros::Time start_time = ros::Time::now();
 
-    while ((cameras_.size() == 0 || cameras_.size() != numTransformedClouds()) && !should_exit_) {
+    {
+      // the transform threads notify under this mutex after publishing, so checking under it cannot miss a frame
       std::unique_lock<std::mutex> lock(transformed_cloud_mutex_);
-      transformed_cloud_cv_.wait_for(lock, std::chrono::milliseconds(5000));
+      while (!camerasReady() && !should_exit_) {
+        transformed_cloud_cv_.wait_for(lock, std::chrono::milliseconds(5000));
+      }
     }
 
     if (should_exit_) break;
 
+    std::unique_ptr<fusedFrame> frame(new fusedFrame);
+    size_t num_new_frames = takeTransformedFrames(fusion_clouds_, fusion_fov_, frame->fov_fcu_frame);
+    frame->position = newest_position_;
+    frame->velocity = velocity_;
+    frame->orientation = newest_orientation_;
+    ROS_INFO("\033[1;35m[OA] Planning started, using %i of %i cameras\n \033[0m", static_cast<int>(num_new_frames),
+             static_cast<int>(fusion_clouds_.size()));
+
+    {
+      std::lock_guard<std::mutex> guard(fusion_mutex_);
+      auto timing = local_planner_->getStageTimer().measure(PlannerStage::process_pointcloud);
+      fusion_.fuse(frame->cloud, fusion_clouds_, fusion_fov_, frame->position,
+                   getYawFromQuaternion(frame->orientation), getPitchFromQuaternion(frame->orientation));
+    }
+
+    // replaces a frame the planning stage did not pick up yet
+    fused_frames_.push(std::move(frame));
+
+    ros::Duration loop_time = ros::Time::now() - start_time;
+    ros::Duration required_delay = ros::Duration(spin_dt_) - loop_time;
+    if (required_delay > ros::Duration(0)) {
+      required_delay.sleep();
+    }
+  }
+}
+
+void LocalPlannerNodelet::planningThread() {
+  std::unique_ptr<fusedFrame> frame;
+  while (fused_frames_.pop(frame)) {
+    std::unique_ptr<plannedFrame> planned(new plannedFrame);
     {
       std::lock_guard<std::mutex> guard(running_mutex_);
-      updatePlannerInfo();
-      local_planner_->runPlanner();
+      updatePlannerInfo(*frame);
+      local_planner_->generate_histogram_image_ = visualizer_.histogramImageSubscribed();
+      local_planner_->generate_cost_image_ = visualizer_.costImageSubscribed();
+      local_planner_->runPlanner(frame->cloud);
+
+      planned->output = local_planner_->getAvoidanceOutput();
+      visualizer_.collectPlannerData(*local_planner_, planned->visualization);
+      // inverted logic to make sure values like NAN default to sending the message
+      if (!(local_planner_->px4_.param_cp_dist < 0)) {
+        local_planner_->getObstacleDistanceData(planned->obstacle_distance);
+      }
+    }
 
-      visualizer_.visualizePlannerData(*(local_planner_.get()), newest_waypoint_position_,
-                                       newest_adapted_waypoint_position_, newest_position_, newest_orientation_);
-      publishLaserScan();
+    // replaces a frame the publishing stage did not pick up yet
+    planned_frames_.push(std::move(planned));
+  }
+}
 
+void LocalPlannerNodelet::publishingThread() {
+  std::unique_ptr<plannedFrame> planned;
+  while (planned_frames_.pop(planned)) {
+    {
       std::lock_guard<std::mutex> lock(waypoints_mutex_);
-      wp_generator_->setPlannerInfo(local_planner_->getAvoidanceOutput());
+      wp_generator_->setPlannerInfo(planned->output);
       last_wp_time_ = ros::Time::now();
     }
 
-    if (should_exit_) break;
-
-    ros::Duration loop_time = last_wp_time_ - start_time;
-    ros::Duration required_delay = ros::Duration(spin_dt_) - loop_time;
-    if (required_delay > ros::Duration(0)) {
-      required_delay.sleep();
+    {
+      auto timing = local_planner_->getStageTimer().measure(PlannerStage::publish);
+      visualizer_.visualizePlannerData(planned->visualization, newest_waypoint_position_,
+                                       newest_adapted_waypoint_position_, newest_position_, newest_orientation_);
+      publishLaserScan(planned->obstacle_distance);
     }
+
+    publishStageTiming();
+  }
+}
+
+void LocalPlannerNodelet::publishStageTiming() {
+  StageTimer& stage_timer = local_planner_->getStageTimer();
+  stage_timer.setEnabled(stage_timing_pub_.getNumSubscribers() > 0);
+  if (!stage_timer.isEnabled()) return;
+
+  ros::WallTime now = ros::WallTime::now();
+  if (now - last_stage_timing_time_ < ros::WallDuration(1.0)) return;
+  last_stage_timing_time_ = now;
+
+  // one row per stage holding the minimum, mean and 99th percentile duration [ms]
+  const size_t num_stages = static_cast<size_t>(PlannerStage::count);
+  std_msgs::Float32MultiArray msg;
+  std::string stage_names;
+  msg.data.reserve(3 * num_stages);
+  for (size_t i = 0; i < num_stages; ++i) {
+    StageStatistics stats = stage_timer.getStatistics(static_cast<PlannerStage>(i));
+    msg.data.push_back(stats.samples > 0 ? stats.min_ms : NAN);
+    msg.data.push_back(stats.samples > 0 ? stats.mean_ms : NAN);
+    msg.data.push_back(stats.samples > 0 ? stats.p99_ms : NAN);
+    stage_names += (i > 0 ? "," : "") + std::string(stageName(static_cast<PlannerStage>(i)));
   }
+  msg.layout.dim.resize(2);
+  msg.layout.dim[0].label = stage_names;
+  msg.layout.dim[0].size = num_stages;
+  msg.layout.dim[0].stride = 3 * num_stages;
+  msg.layout.dim[1].label = "min_ms,mean_ms,p99_ms";
+  msg.layout.dim[1].size = 3;
+  msg.layout.dim[1].stride = 3;
+  stage_timing_pub_.publish(msg);
 }
 
 void LocalPlannerNodelet::checkFailsafe(ros::Duration since_last_cloud, ros::Duration since_start, bool& hover) {
@@ -492,45 +675,69 @@ void LocalPlannerNodelet::checkFailsafe(ros::Duration since_last_cloud, ros::Dur
 }
 
 void LocalPlannerNodelet::pointCloudTransformThread(int index) {
+  cameraData& camera = cameras_[index];
   while (!should_exit_) {
-    bool waiting_on_transform = false;
-    bool waiting_on_cloud = false;
-    {
-      std::lock_guard<std::mutex> camera_lock(*(cameras_[index].camera_mutex_));
-
-      if (cameras_[index].received_) {
-        tf::StampedTransform cloud_transform;
-        tf::StampedTransform fcu_transform;
-
-        if (tf_buffer_.getTransform(cameras_[index].untransformed_cloud_.header.frame_id, "/local_origin",
-                                    pcl_conversions::fromPCL(cameras_[index].untransformed_cloud_.header.stamp),
-                                    cloud_transform) &&
-            tf_buffer_.getTransform(cameras_[index].untransformed_cloud_.header.frame_id, "/fcu",
-                                    pcl_conversions::fromPCL(cameras_[index].untransformed_cloud_.header.stamp),
-                                    fcu_transform)) {
-          // remove nan padding and compute fov
-          pcl::PointCloud<pcl::PointXYZ> maxima = removeNaNAndGetMaxima(cameras_[index].untransformed_cloud_);
+    // take the newest received cloud. A cloud waiting for its transform is only replaced once the new one is
+    // sufficiently newer, otherwise a slow transform could starve the camera
+    if (camera.received_cloud_->update()) {
+      sensor_msgs::PointCloud2::ConstPtr& received = camera.received_cloud_->read();
+      if (!camera.untransformed_cloud_ ||
+          received->header.stamp - camera.untransformed_cloud_->header.stamp >= ros::Duration(0.3)) {
+        camera.untransformed_cloud_ = received;
+      }
+      received.reset();
+    }
 
+    bool waiting_on_transform = false;
+    if (camera.untransformed_cloud_) {
+      tf::StampedTransform fcu_transform;
+
+      // when de-skewing, the rows are spread over the scan time around the stamp and the last ones need the
+      // transforms after it
+      const std_msgs::Header& header = camera.untransformed_cloud_->header;
+      const float scan_time_s = deskew_scan_time_s_;
+      const ros::Duration scan_duration(scan_time_s > 0.f ? scan_time_s : 0.f);
+      const size_t num_slices = scan_time_s > 0.f ? static_cast<size_t>(std::max(1, deskew_slices_.load())) : 1;
+      {
+        // registered before the lookup, so a transform landing in between still wakes the thread
+        std::lock_guard<std::mutex> lck(*(camera.camera_mutex_));
+        camera.transform_wait_stamp_ = header.stamp + ros::Duration(0.5 * scan_duration.toSec());
+        camera.transform_wait_frame_ = header.frame_id;
+      }
+      if (header.frame_id != camera.frame_id_) {
+        camera.local_origin_frame_pair_ = tf_buffer_.getFramePairHandle(header.frame_id, "/local_origin");
+        camera.fcu_frame_pair_ = tf_buffer_.getFramePairHandle(header.frame_id, "/fcu");
+        camera.frame_id_ = header.frame_id;
+      }
+      auto lookup = [&](const ros::Time& time, tf::StampedTransform& transform) {
+        return tf_buffer_.getTransform(camera.local_origin_frame_pair_, time, transform);
+      };
+      if (getSliceTransforms(header.stamp, scan_duration, num_slices, lookup, camera.slice_transforms_) &&
+          tf_buffer_.getTransform(camera.fcu_frame_pair_, header.stamp, fcu_transform)) {
+        auto timing = local_planner_->getStageTimer().measure(PlannerStage::transform);
+        // remove nan padding, compute fov, transform to /local_origin frame and crop in one pass over the message
+        transformedFrame& frame = camera.transformed_frame_->write();
+        pcl::PointCloud<pcl::PointXYZ> maxima;
+        if (transformPointCloud2AndGetMaxima(*camera.untransformed_cloud_, camera.slice_transforms_,
+                                             max_sensor_range_, frame.cloud, maxima)) {
           // update point cloud FOV
           pcl_ros::transformPointCloud(maxima, maxima, fcu_transform);
-          updateFOVFromMaxima(cameras_[index].fov_fcu_frame_, maxima);
+          updateFOVFromMaxima(camera.fov_fcu_frame_, maxima);
 
-          // transform cloud to /local_origin frame
-          pcl_ros::transformPointCloud(cameras_[index].untransformed_cloud_, cameras_[index].transformed_cloud_,
-                                       cloud_transform);
-          cameras_[index].transformed_cloud_.header.frame_id = "/local_origin";
-          cameras_[index].transformed_cloud_.header.stamp = cameras_[index].untransformed_cloud_.header.stamp;
+          frame.cloud.header.frame_id = "/local_origin";
+          frame.cloud.header.stamp = pcl_conversions::toPCL(header.stamp);
+          frame.fov_fcu_frame = camera.fov_fcu_frame_;
+          camera.transformed_frame_->publish();
 
-          cameras_[index].transformed_ = true;
-          cameras_[index].received_ = false;
-          waiting_on_cloud = true;
           std::lock_guard<std::mutex> lock(transformed_cloud_mutex_);
           transformed_cloud_cv_.notify_all();
         } else {
-          waiting_on_transform = true;
+          ROS_WARN_THROTTLE(5.0, "[OA] Pointcloud on %s has no FLOAT32 x, y, z fields, dropping it",
+                            camera.topic_.c_str());
         }
+        camera.untransformed_cloud_.reset();
       } else {
-        waiting_on_cloud = true;
+        waiting_on_transform = true;
       }
     }
 
@@ -538,12 +745,15 @@ void LocalPlannerNodelet::pointCloudTransformThread(int index) {
       break;
     }
 
+    std::unique_lock<std::mutex> lck(*(camera.camera_mutex_));
     if (waiting_on_transform) {
-      std::unique_lock<std::mutex> lck(buffered_transforms_mutex_);
-      tf_buffer_cv_.wait_for(lck, std::chrono::milliseconds(5000));
-    } else if (waiting_on_cloud) {
-      std::unique_lock<std::mutex> lck(*(cameras_[index].camera_mutex_));
-      cameras_[index].camera_cv_->wait_for(lck, std::chrono::milliseconds(5000));
+      camera.camera_cv_->wait_for(lck, std::chrono::milliseconds(5000), [&]() {
+        return camera.transform_wait_stamp_.isZero() || camera.received_cloud_->hasNewData() || should_exit_;
+      });
+    } else {
+      camera.transform_wait_stamp_ = ros::Time();
+      camera.camera_cv_->wait_for(lck, std::chrono::milliseconds(5000),
+                                  [&]() { return camera.received_cloud_->hasNewData() || should_exit_; });
     }
   }
 }
@@ -0,0 +1,318 @@
+#include "local_planner/local_planner.h"
+#include "local_planner/stage_timer.h"
+#include "local_planner/waypoint_generator.h"
+
+#include <avoidance/common.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <mavros_msgs/State.h>
+#include <pcl/common/transforms.h>
+#include <pcl_conversions/pcl_conversions.h>
+#include <ros/ros.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/PointCloud2.h>
+#include <tf/transform_datatypes.h>
+#include <tf2/buffer_core.h>
+#include <tf2/exceptions.h>
+#include <tf2_msgs/TFMessage.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/**
+* Replays a bag through the local planner and the waypoint generator in a
+* single thread, as fast as possible. The ROS clock is driven by the bag
+* timestamps, so the same bag and parameters always produce the same
+* setpoints. Nothing is published, no roscore is needed.
+*
+* usage: local_planner_replay <bag> --cloud <topic> [--cloud <topic> ...]
+*                             [--goal <x> <y> <z>] [--dt <s>] [--setpoints <file.csv>]
+**/
+
+using namespace avoidance;
+
+namespace {
+
+struct ReplayCamera {
+  std::string topic;
+  sensor_msgs::PointCloud2::ConstPtr untransformed_cloud;
+  pcl::PointCloud<pcl::PointXYZ> transformed_cloud;
+  bool transformed = false;
+  FOV fov_fcu_frame;
+};
+
+// tf2 does not accept frame ids with a leading slash, which are common in older bags
+std::string stripSlash(const std::string& frame_id) {
+  return (!frame_id.empty() && frame_id[0] == '/') ? frame_id.substr(1) : frame_id;
+}
+
+bool lookupTransform(const tf2::BufferCore& buffer, const std::string& target, const std::string& source,
+                     const ros::Time& stamp, Eigen::Affine3f& transform) {
+  if (!buffer.canTransform(target, source, stamp)) return false;
+  try {
+    tf::Transform tf_transform;
+    tf::transformMsgToTF(buffer.lookupTransform(target, source, stamp).transform, tf_transform);
+    transform = toEigen(tf_transform);
+    return true;
+  } catch (tf2::TransformException& ex) {
+    return false;
+  }
+}
+
+NavigationState navigationStateFromMode(const std::string& mode) {
+  if (mode == "AUTO.MISSION") return NavigationState::mission;
+  if (mode == "AUTO.TAKEOFF") return NavigationState::auto_takeoff;
+  if (mode == "AUTO.LAND") return NavigationState::auto_land;
+  if (mode == "AUTO.RTL") return NavigationState::auto_rtl;
+  if (mode == "AUTO.RTGS") return NavigationState::auto_rtgs;
+  if (mode == "AUTO.LOITER") return NavigationState::auto_loiter;
+  if (mode == "OFFBOARD") return NavigationState::offboard;
+  return NavigationState::none;
+}
+
+void printUsage(const char* name) {
+  std::fprintf(stderr,
+               "usage: %s <bag> --cloud <topic> [--cloud <topic> ...] [--goal <x> <y> <z>] [--dt <s>] "
+               "[--setpoints <file.csv>]\n",
+               name);
+}
+}
+
+int main(int argc, char** argv) {
+  std::string bag_path;
+  std::string setpoints_path;
+  std::vector<ReplayCamera> cameras;
+  Eigen::Vector3f goal(15.f, 15.f, 4.f);
+  double dt = 0.1;
+
+  for (int i = 1; i < argc; i++) {
+    if (!std::strcmp(argv[i], "--cloud") && i + 1 < argc) {
+      cameras.emplace_back();
+      cameras.back().topic = argv[++i];
+    } else if (!std::strcmp(argv[i], "--goal") && i + 3 < argc) {
+      goal = Eigen::Vector3f(std::atof(argv[i + 1]), std::atof(argv[i + 2]), std::atof(argv[i + 3]));
+      i += 3;
+    } else if (!std::strcmp(argv[i], "--dt") && i + 1 < argc) {
+      dt = std::atof(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--setpoints") && i + 1 < argc) {
+      setpoints_path = argv[++i];
+    } else if (argv[i][0] != '-' && bag_path.empty()) {
+      bag_path = argv[i];
+    } else {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+  if (bag_path.empty() || cameras.empty() || !(dt > 0.0)) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  // the planner logs every cycle, which would dominate the replay time
+  if (ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn)) {
+    ros::console::notifyLoggerLevelsChanged();
+  }
+
+  const std::string pose_topic = "/mavros/local_position/pose";
+  const std::string velocity_topic = "/mavros/local_position/velocity_local";
+  const std::string state_topic = "/mavros/state";
+  std::vector<std::string> topics = {"/tf", "/tf_static", pose_topic, velocity_topic, state_topic};
+  for (const ReplayCamera& camera : cameras) topics.push_back(camera.topic);
+
+  rosbag::Bag bag;
+  try {
+    bag.open(bag_path, rosbag::bagmode::Read);
+  } catch (rosbag::BagException& ex) {
+    std::fprintf(stderr, "Could not open %s: %s\n", bag_path.c_str(), ex.what());
+    return 1;
+  }
+  rosbag::View view(bag, rosbag::TopicQuery(topics));
+  if (view.size() == 0) {
+    std::fprintf(stderr, "No matching messages in %s\n", bag_path.c_str());
+    return 1;
+  }
+
+  FILE* setpoints = nullptr;
+  if (!setpoints_path.empty()) {
+    setpoints = std::fopen(setpoints_path.c_str(), "w");
+    if (!setpoints) {
+      std::fprintf(stderr, "Could not open %s for writing\n", setpoints_path.c_str());
+      return 1;
+    }
+    std::fprintf(setpoints, "time,x,y,z,vx,vy,vz,yaw,waypoint_type\n");
+  }
+
+  // simulated time, starting at the beginning of the bag. setNow does not
+  // initialize the clock, without init() every ros::Time::now() throws
+  ros::Time::init();
+  ros::Time::setNow(view.getBeginTime());
+
+  LocalPlanner planner;
+  WaypointGenerator wp_generator;
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  planner.dynamicReconfigureSetParams(config, 1);
+  planner.setDefaultPx4Parameters();
+  planner.setGoal(goal);
+  planner.setPreviousGoal(goal);
+  planner.applyGoal();
+  wp_generator.setSmoothingSpeed(config.smoothing_speed_xy_, config.smoothing_speed_z_);
+
+  // keep every cycle so the statistics cover the whole bag
+  StageTimer& stage_timer = planner.getStageTimer();
+  stage_timer.setWindowSize(view.size());
+  stage_timer.setEnabled(true);
+
+  const ros::Duration bag_duration = view.getEndTime() - view.getBeginTime();
+  tf2::BufferCore tf_buffer(bag_duration + ros::Duration(10.0));
+
+  Eigen::Vector3f position(NAN, NAN, NAN);
+  Eigen::Quaternionf orientation = Eigen::Quaternionf::Identity();
+  Eigen::Vector3f velocity = Eigen::Vector3f::Zero();
+  const Eigen::Vector3f desired_velocity(NAN, NAN, NAN);
+  // without state messages the vehicle is assumed to fly in offboard mode
+  bool armed = true;
+  NavigationState nav_state = NavigationState::offboard;
+
+  ros::Time next_plan_time = view.getBeginTime();
+  ros::Time next_cmd_time = view.getBeginTime();
+  bool planner_ran = false;
+  size_t planner_cycles = 0;
+  size_t setpoint_count = 0;
+
+  auto sendWaypoint = [&](const ros::Time& now) {
+    ros::Time::setNow(now);
+    waypointResult result;
+    {
+      auto timing = stage_timer.measure(PlannerStage::waypoint);
+      wp_generator.updateState(position, orientation, goal, goal, velocity, false,
+                               armed && nav_state != NavigationState::none, nav_state, false, false,
+                               desired_velocity);
+      result = wp_generator.getWaypoints();
+    }
+    if (setpoints) {
+      std::fprintf(setpoints, "%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%d\n", now.toSec(), result.position_wp.x(),
+                   result.position_wp.y(), result.position_wp.z(), result.linear_velocity_wp.x(),
+                   result.linear_velocity_wp.y(), result.linear_velocity_wp.z(),
+                   getYawFromQuaternion(result.orientation_wp), static_cast<int>(result.waypoint_type));
+    }
+    setpoint_count++;
+  };
+
+  auto tryTransform = [&](ReplayCamera& camera) {
+    if (!camera.untransformed_cloud) return;
+    const std_msgs::Header& header = camera.untransformed_cloud->header;
+    const std::string frame_id = stripSlash(header.frame_id);
+    Eigen::Affine3f cloud_transform, fcu_transform;
+    if (!lookupTransform(tf_buffer, "local_origin", frame_id, header.stamp, cloud_transform) ||
+        !lookupTransform(tf_buffer, "fcu", frame_id, header.stamp, fcu_transform)) {
+      return;
+    }
+
+    auto timing = stage_timer.measure(PlannerStage::transform);
+    pcl::PointCloud<pcl::PointXYZ> maxima;
+    if (transformPointCloud2AndGetMaxima(*camera.untransformed_cloud, cloud_transform, config.max_sensor_range_,
+                                         camera.transformed_cloud, maxima)) {
+      pcl::transformPointCloud(maxima, maxima, fcu_transform);
+      updateFOVFromMaxima(camera.fov_fcu_frame, maxima);
+      camera.transformed_cloud.header.frame_id = "/local_origin";
+      camera.transformed_cloud.header.stamp = pcl_conversions::toPCL(header.stamp);
+      camera.transformed = true;
+    }
+    camera.untransformed_cloud.reset();
+  };
+
+  ros::WallTime replay_start = ros::WallTime::now();
+  for (const rosbag::MessageInstance& m : view) {
+    const ros::Time stamp = m.getTime();
+
+    // the setpoint loop runs at a fixed rate, independent of the planner
+    while (planner_ran && next_cmd_time <= stamp) {
+      sendWaypoint(next_cmd_time);
+      next_cmd_time += ros::Duration(dt);
+    }
+    ros::Time::setNow(stamp);
+
+    const std::string& topic = m.getTopic();
+    if (topic == "/tf" || topic == "/tf_static") {
+      tf2_msgs::TFMessage::ConstPtr tf_msg = m.instantiate<tf2_msgs::TFMessage>();
+      if (!tf_msg) continue;
+      for (geometry_msgs::TransformStamped transform : tf_msg->transforms) {
+        transform.header.frame_id = stripSlash(transform.header.frame_id);
+        transform.child_frame_id = stripSlash(transform.child_frame_id);
+        tf_buffer.setTransform(transform, "bag", topic == "/tf_static");
+      }
+    } else if (topic == pose_topic) {
+      geometry_msgs::PoseStamped::ConstPtr pose = m.instantiate<geometry_msgs::PoseStamped>();
+      if (!pose) continue;
+      position = toEigen(pose->pose.position);
+      orientation = toEigen(pose->pose.orientation);
+    } else if (topic == velocity_topic) {
+      geometry_msgs::TwistStamped::ConstPtr twist = m.instantiate<geometry_msgs::TwistStamped>();
+      if (!twist) continue;
+      velocity = toEigen(twist->twist.linear);
+    } else if (topic == state_topic) {
+      mavros_msgs::State::ConstPtr state = m.instantiate<mavros_msgs::State>();
+      if (!state) continue;
+      armed = state->armed;
+      nav_state = navigationStateFromMode(state->mode);
+    } else {
+      for (ReplayCamera& camera : cameras) {
+        if (topic != camera.topic) continue;
+        camera.untransformed_cloud = m.instantiate<sensor_msgs::PointCloud2>();
+        if (camera.untransformed_cloud) {
+          stage_timer.addSample(PlannerStage::cloud_receive,
+                                1000.f * (stamp - camera.untransformed_cloud->header.stamp).toSec());
+        }
+      }
+    }
+
+    if (stamp < next_plan_time || !std::isfinite(position.x())) continue;
+
+    // transforms can arrive after the cloud, retry the pending clouds with every message
+    size_t num_transformed = 0;
+    for (ReplayCamera& camera : cameras) {
+      if (!camera.transformed) tryTransform(camera);
+      if (camera.transformed) num_transformed++;
+    }
+    if (num_transformed < cameras.size()) continue;
+
+    planner.original_cloud_vector_.resize(cameras.size());
+    for (size_t i = 0; i < cameras.size(); i++) {
+      std::swap(planner.original_cloud_vector_[i], cameras[i].transformed_cloud);
+      cameras[i].transformed_cloud.clear();
+      cameras[i].transformed = false;
+      planner.setFOV(i, cameras[i].fov_fcu_frame);
+      wp_generator.setFOV(i, cameras[i].fov_fcu_frame);
+    }
+    planner.setState(position, velocity, orientation);
+    planner.currently_armed_ = armed;
+    planner.runPlanner();
+    wp_generator.setPlannerInfo(planner.getAvoidanceOutput());
+    planner_cycles++;
+
+    if (!planner_ran) next_cmd_time = stamp;
+    planner_ran = true;
+    next_plan_time = stamp + ros::Duration(dt);
+  }
+  const double wall_time = (ros::WallTime::now() - replay_start).toSec();
+  bag.close();
+  if (setpoints) std::fclose(setpoints);
+
+  std::printf("replayed %.1f s of data in %.2f s (%.1fx real time): %zu planner cycles, %zu setpoints\n",
+              bag_duration.toSec(), wall_time, wall_time > 0.0 ? bag_duration.toSec() / wall_time : 0.0,
+              planner_cycles, setpoint_count);
+  std::printf("%-20s %8s %10s %10s %10s\n", "stage", "samples", "min [ms]", "mean [ms]", "p99 [ms]");
+  for (size_t i = 0; i < static_cast<size_t>(PlannerStage::count); i++) {
+    const PlannerStage stage = static_cast<PlannerStage>(i);
+    StageStatistics stats = stage_timer.getStatistics(stage);
+    if (stats.samples == 0) continue;
+    std::printf("%-20s %8zu %10.3f %10.3f %10.3f\n", stageName(stage), stats.samples, stats.min_ms, stats.mean_ms,
+                stats.p99_ms);
+  }
+  return 0;
+}
@@ -33,39 +33,63 @@ void LocalPlannerVisualization::initializePublishers(ros::NodeHandle& nh) {
   range_scan_pub_ = nh.advertise<visualization_msgs::Marker>("/range_scan", 1);
 }
 
-void LocalPlannerVisualization::visualizePlannerData(const LocalPlanner& planner,
+void LocalPlannerVisualization::collectPlannerData(const LocalPlanner& planner, plannerVisualizationData& data) const {
+  data.pointcloud.clear();
+  if (local_pointcloud_pub_.getNumSubscribers() > 0) {
+    data.pointcloud = planner.getPointcloud();
+  }
+  data.pointcloud_size = static_cast<uint32_t>(planner.getPointcloud().size());
+
+  data.tree.clear();
+  data.closed_set.clear();
+  data.path_node_positions.clear();
+  if (complete_tree_pub_.getNumSubscribers() > 0 || tree_path_pub_.getNumSubscribers() > 0) {
+    planner.getTree(data.tree, data.closed_set, data.path_node_positions);
+  }
+
+  data.goal = planner.getGoal();
+  data.histogram_image_data = planner.histogram_image_data_;
+  data.cost_image_data = planner.cost_image_data_;
+  data.fov = planner.getFOV();
+  data.sensor_range = planner.getSensorRange();
+  data.range_scan = planner.distance_data_;
+}
+
+void LocalPlannerVisualization::visualizePlannerData(const plannerVisualizationData& data,
                                                      const Eigen::Vector3f& newest_waypoint_position,
                                                      const Eigen::Vector3f& newest_adapted_waypoint_position,
                                                      const Eigen::Vector3f& newest_position,
                                                      const Eigen::Quaternionf& newest_orientation) const {
   // visualize clouds
-  local_pointcloud_pub_.publish(planner.getPointcloud());
+  if (local_pointcloud_pub_.getNumSubscribers() > 0) {
+    local_pointcloud_pub_.publish(data.pointcloud);
+  }
   std_msgs::UInt32 msg;
-  msg.data = static_cast<uint32_t>(planner.getPointcloud().size());
+  msg.data = data.pointcloud_size;
   pointcloud_size_pub_.publish(msg);
 
   // visualize tree calculation
-  std::vector<TreeNode> tree;
-  std::vector<int> closed_set;
-  std::vector<Eigen::Vector3f> path_node_positions;
-  planner.getTree(tree, closed_set, path_node_positions);
-  publishTree(tree, closed_set, path_node_positions);
+  if (complete_tree_pub_.getNumSubscribers() > 0 || tree_path_pub_.getNumSubscribers() > 0) {
+    publishTree(data.tree, data.closed_set, data.path_node_positions);
+  }
 
   // visualize goal
-  publishGoal(toPoint(planner.getGoal()));
+  publishGoal(toPoint(data.goal));
 
   // publish histogram image
-  publishDataImages(planner.histogram_image_data_, planner.cost_image_data_, newest_waypoint_position,
+  publishDataImages(data.histogram_image_data, data.cost_image_data, newest_waypoint_position,
                     newest_adapted_waypoint_position, newest_position, newest_orientation);
 
   // publish the FOV
-  publishFOV(planner.getFOV(), planner.getSensorRange());
+  publishFOV(data.fov, data.sensor_range);
 
   // range scan
-  publishRangeScan(planner.distance_data_, newest_position);
+  publishRangeScan(data.range_scan, newest_position);
 }
 
 void LocalPlannerVisualization::publishFOV(const std::vector<FOV>& fov_vec, float max_range) const {
+  if (fov_pub_.getNumSubscribers() == 0) return;
+
   Eigen::Vector3f drone_pos = Eigen::Vector3f(0.f, 0.f, 0.f);
   for (int i = 0; i < fov_vec.size(); ++i) {
     PolarPoint p1(fov_vec[i].pitch_deg - fov_vec[i].v_fov_deg / 2.f, fov_vec[i].yaw_deg + fov_vec[i].h_fov_deg / 2.f,
@@ -114,6 +138,8 @@ void LocalPlannerVisualization::publishFOV(const std::vector<FOV>& fov_vec, floa
 
 void LocalPlannerVisualization::publishRangeScan(const sensor_msgs::LaserScan& scan,
                                                  const Eigen::Vector3f& newest_position) const {
+  if (range_scan_pub_.getNumSubscribers() == 0) return;
+
   visualization_msgs::Marker m;
   m.header.frame_id = "local_origin";
   m.header.stamp = ros::Time::now();
@@ -268,6 +294,20 @@ void LocalPlannerVisualization::publishDataImages(const std::vector<uint8_t>& hi
                                                   const Eigen::Vector3f& newest_adapted_waypoint_position,
                                                   const Eigen::Vector3f& newest_position,
                                                   const Eigen::Quaternionf newest_orientation) const {
+  if (histogram_image_pub_.getNumSubscribers() > 0) {
+    sensor_msgs::Image hist_img;
+    hist_img.header.stamp = ros::Time::now();
+    hist_img.height = GRID_LENGTH_E;
+    hist_img.width = GRID_LENGTH_Z;
+    hist_img.encoding = sensor_msgs::image_encodings::MONO8;
+    hist_img.is_bigendian = 0;
+    hist_img.step = 255;
+    hist_img.data = histogram_image_data;
+    histogram_image_pub_.publish(hist_img);
+  }
+
+  if (cost_image_pub_.getNumSubscribers() == 0) return;
+
   sensor_msgs::Image cost_img;
   cost_img.header.stamp = ros::Time::now();
   cost_img.height = GRID_LENGTH_E;
@@ -304,17 +344,6 @@ void LocalPlannerVisualization::publishDataImages(const std::vector<uint8_t>& hi
     cost_img.data[colorImageIndex(adapted_waypoint_index.y(), adapted_waypoint_index.x(), 2)] = 255.f;
   }
 
-  // histogram image
-  sensor_msgs::Image hist_img;
-  hist_img.header.stamp = ros::Time::now();
-  hist_img.height = GRID_LENGTH_E;
-  hist_img.width = GRID_LENGTH_Z;
-  hist_img.encoding = sensor_msgs::image_encodings::MONO8;
-  hist_img.is_bigendian = 0;
-  hist_img.step = 255;
-  hist_img.data = histogram_image_data;
-
-  histogram_image_pub_.publish(hist_img);
   cost_image_pub_.publish(cost_img);
 }
 
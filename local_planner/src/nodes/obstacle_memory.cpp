@@ -0,0 +1,142 @@
+#include "local_planner/obstacle_memory.h"
+
+#include "avoidance/common.h"
+
+#include <algorithm>
+
+namespace avoidance {
+
+ObstacleMemory::ObstacleMemory(int res)
+    : res_{res}, z_dim_{360 / res}, time_s_{0.f}, origin_{Eigen::Vector3f::Zero()}, slots_((180 / res) * z_dim_, -1) {
+  cells_.height = 1;
+}
+
+void ObstacleMemory::expire(float max_age) {
+  while (!expiry_queue_.empty() && time_s_ - expiry_queue_.front().first >= max_age) {
+    const std::pair<float, int> entry = expiry_queue_.front();
+    expiry_queue_.pop_front();
+    // the bin may have been observed again or forgotten since
+    const int index = slots_[entry.second];
+    if (index >= 0 && cells_.points[index].intensity == entry.first) {
+      erase(index);
+    }
+  }
+}
+
+bool ObstacleMemory::moveTo(const Eigen::Vector3f& position, float max_range, float tolerance) {
+  if ((position - origin_).norm() <= tolerance) {
+    return false;
+  }
+  origin_ = position;
+
+  Eigen::ArrayXi e_index, z_index;
+  Eigen::ArrayXf radius;
+  cartesianToHistogramIndex(cells_, origin_, res_, e_index, z_index, radius);
+
+  // compact the cells in place, moved[i] is the new index of cell i or -1 if it was dropped
+  std::vector<int> old_slots(slots_.size(), -1);
+  old_slots.swap(slots_);
+  std::vector<int> moved(cells_.points.size(), -1);
+  std::vector<size_t> source(cells_.points.size());
+  size_t kept = 0;
+  for (size_t i = 0; i < cells_.points.size(); ++i) {
+    if (!(radius[i] < max_range)) {
+      continue;
+    }
+    const int bin = e_index[i] * z_dim_ + z_index[i];
+    const int j = slots_[bin];
+    if (j < 0) {
+      cells_.points[kept] = cells_.points[i];
+      bins_[kept] = bin;
+      source[kept] = i;
+      slots_[bin] = kept;
+      moved[i] = kept;
+      ++kept;
+    } else if (cells_.points[i].intensity > cells_.points[j].intensity) {
+      // two cells moved into the same bin, the newer observation wins
+      cells_.points[j] = cells_.points[i];
+      moved[source[j]] = -1;
+      source[j] = i;
+      moved[i] = j;
+    }
+  }
+  cells_.points.resize(kept);
+  cells_.width = kept;
+  bins_.resize(kept);
+
+  // follow the surviving cells to their new bins, the queue stays in stamp order
+  std::deque<std::pair<float, int>> expiry_queue;
+  for (const std::pair<float, int>& entry : expiry_queue_) {
+    const int old_index = old_slots[entry.second];
+    const int new_index = old_index < 0 ? -1 : moved[old_index];
+    if (new_index >= 0 && cells_.points[new_index].intensity == entry.first) {
+      expiry_queue.emplace_back(entry.first, bins_[new_index]);
+    }
+  }
+  expiry_queue_.swap(expiry_queue);
+  return true;
+}
+
+void ObstacleMemory::insert(int e, int z, const Eigen::Vector3f& point, float age) {
+  const int bin = e * z_dim_ + z;
+  pcl::PointXYZI cell;
+  cell.x = point.x();
+  cell.y = point.y();
+  cell.z = point.z();
+  cell.intensity = time_s_ - age;
+
+  if (slots_[bin] >= 0) {
+    cells_.points[slots_[bin]] = cell;
+  } else {
+    slots_[bin] = cells_.points.size();
+    cells_.points.push_back(cell);
+    bins_.push_back(bin);
+    cells_.width = cells_.points.size();
+  }
+
+  if (expiry_queue_.empty() || expiry_queue_.back().first <= cell.intensity) {
+    expiry_queue_.emplace_back(cell.intensity, bin);
+  } else {
+    // only observations inserted with an age arrive out of order
+    auto it = std::upper_bound(
+        expiry_queue_.begin(), expiry_queue_.end(), cell.intensity,
+        [](float stamp, const std::pair<float, int>& entry) { return stamp < entry.first; });
+    expiry_queue_.emplace(it, cell.intensity, bin);
+  }
+}
+
+void ObstacleMemory::insert(const Eigen::Vector3f& point, float age) {
+  Eigen::ArrayXi e_index, z_index;
+  Eigen::ArrayXf radius;
+  cartesianToHistogramIndex(Eigen::ArrayXf::Constant(1, point.x()), Eigen::ArrayXf::Constant(1, point.y()),
+                            Eigen::ArrayXf::Constant(1, point.z()), origin_, res_, e_index, z_index, radius);
+  insert(e_index[0], z_index[0], point, age);
+}
+
+void ObstacleMemory::forget(int bin) {
+  if (slots_[bin] >= 0) {
+    erase(slots_[bin]);
+  }
+}
+
+void ObstacleMemory::erase(size_t index) {
+  const size_t last = cells_.points.size() - 1;
+  slots_[bins_[index]] = -1;
+  if (index != last) {
+    cells_.points[index] = cells_.points[last];
+    bins_[index] = bins_[last];
+    slots_[bins_[index]] = index;
+  }
+  cells_.points.pop_back();
+  cells_.width = cells_.points.size();
+  bins_.pop_back();
+}
+
+void ObstacleMemory::clear() {
+  cells_.points.clear();
+  cells_.width = 0;
+  bins_.clear();
+  std::fill(slots_.begin(), slots_.end(), -1);
+  expiry_queue_.clear();
+}
+}
@@ -1,76 +1,113 @@
 #include "local_planner/planner_functions.h"
 
 #include "avoidance/common.h"
+#include "avoidance/histogram_geometry.h"
 
 #include <ros/console.h>
 
+#include <algorithm>
+#include <cmath>
 #include <numeric>
 
+namespace {
+// filters every column with the conic kernel of getConicKernel(radius). The kernel is the
+// convolution of two box filters of length radius + 1, so both are applied as running sums and
+// the cost per cell does not depend on the radius. The first and last radius rows of the input
+// are only used as padding, the output has input.rows() - 2 * radius rows.
+void conicFilterColumns(const Eigen::MatrixXf& input, int radius, Eigen::MatrixXf& output) {
+  const int box_length = radius + 1;
+  const int rows = input.rows() - 2 * radius;
+
+  // box(j) = input(j) + ... + input(j + radius)
+  Eigen::MatrixXf box(rows + radius, input.cols());
+  Eigen::RowVectorXf sum = input.topRows(box_length).colwise().sum();
+  box.row(0) = sum;
+  for (int j = 1; j < box.rows(); j++) {
+    sum += input.row(j + radius) - input.row(j - 1);
+    box.row(j) = sum;
+  }
+
+  // the kernel peak is normalized to one
+  output.resize(rows, input.cols());
+  sum = box.topRows(box_length).colwise().sum();
+  output.row(0) = sum / box_length;
+  for (int i = 1; i < rows; i++) {
+    sum += box.row(i + radius) - box.row(i - 1);
+    output.row(i) = sum / box_length;
+  }
+}
+}
+
 namespace avoidance {
 
 // trim the point cloud so that only one valid point per histogram cell is around
-void processPointcloud(pcl::PointCloud<pcl::PointXYZI>& final_cloud,
+void processPointcloud(pcl::PointCloud<pcl::PointXYZI>& final_cloud, ObstacleMemory& memory, FOVMask& fov_mask,
                        const std::vector<pcl::PointCloud<pcl::PointXYZ>>& complete_cloud, const std::vector<FOV>& fov,
                        float yaw_fcu_frame_deg, float pitch_fcu_frame_deg, const Eigen::Vector3f& position,
                        float min_sensor_range, float max_sensor_range, float max_age, float elapsed_s,
                        int min_num_points_per_cell) {
-  const int SCALE_FACTOR = 3;
-  pcl::PointCloud<pcl::PointXYZI> old_cloud;
-  std::swap(final_cloud, old_cloud);
-  final_cloud.points.clear();
-  final_cloud.width = 0;
-  final_cloud.points.reserve((SCALE_FACTOR * GRID_LENGTH_Z) * (SCALE_FACTOR * GRID_LENGTH_E));
+  // the memory bins are the fine grid of the cloud subsampling
+  const int res = memory.res();
+  const int z_dim = 360 / res;
+  memory.advance(elapsed_s);
+  memory.expire(max_age);
+  // the grid is only rebuilt once the vehicle moved by half a bin at the minimum range, so it isn't rebuilt every
+  // cycle of a hovering vehicle with a noisy position estimate
+  memory.moveTo(position, max_sensor_range, 0.5f * min_sensor_range * res * DEG_TO_RAD);
+  const Eigen::Vector3f& origin = memory.origin();
+  const bool centered = origin == position;
+
+  // the camera would have seen the remembered cells inside the FOV, only the covered bins are visited
+  fov_mask.update(fov, yaw_fcu_frame_deg, pitch_fcu_frame_deg, res);
+  for (int bin : fov_mask.coveredCells()) {
+    const pcl::PointXYZI* cell = memory.cell(bin);
+    if (!cell) continue;
+    Eigen::Vector2i index(bin % z_dim, bin / z_dim);
+    if (!centered) {
+      // the bins are around the grid origin, the FOV is tested at the bin of the cell around the vehicle
+      index = polarToHistogramIndex(cartesianToPolarHistogram(toEigen(*cell), position), res);
+    }
+    if (fov_mask.pointInsideFOV(index.y(), index.x(), toEigen(*cell), position)) {
+      memory.forget(bin);
+    }
+  }
 
   // counter to keep track of how many points lie in a given cell
-  Eigen::MatrixXi histogram_points_counter(180 / (ALPHA_RES / SCALE_FACTOR), 360 / (ALPHA_RES / SCALE_FACTOR));
+  Eigen::MatrixXi histogram_points_counter(180 / res, z_dim);
   histogram_points_counter.fill(0);
 
-  auto sqr = [](float f) { return f * f; };
+  // bin indices of all points of a cloud are computed in one batch
+  Eigen::ArrayXi e_index, z_index;
+  Eigen::ArrayXf radius;
 
+  // the new points are binned and range checked around the grid origin, which is close enough to the vehicle
   for (const auto& cloud : complete_cloud) {
-    for (const pcl::PointXYZ& xyz : cloud) {
-      // Check if the point is invalid
-      if (!std::isnan(xyz.x) && !std::isnan(xyz.y) && !std::isnan(xyz.z)) {
-        float distanceSq = (position - toEigen(xyz)).squaredNorm();
-        if (sqr(min_sensor_range) < distanceSq && distanceSq < sqr(max_sensor_range)) {
-          // subsampling the cloud
-          PolarPoint p_pol = cartesianToPolarHistogram(toEigen(xyz), position);
-          Eigen::Vector2i p_ind = polarToHistogramIndex(p_pol, ALPHA_RES / SCALE_FACTOR);
-          histogram_points_counter(p_ind.y(), p_ind.x())++;
-          if (histogram_points_counter(p_ind.y(), p_ind.x()) == min_num_points_per_cell) {
-            final_cloud.points.push_back(toXYZI(toEigen(xyz), 0.0f));
-          }
+    cartesianToHistogramIndex(cloud, origin, res, e_index, z_index, radius);
+    for (size_t i = 0; i < cloud.points.size(); ++i) {
+      // invalid (NAN) points have a NAN radius and fail the range check
+      if (min_sensor_range < radius[i] && radius[i] < max_sensor_range) {
+        // subsampling the cloud, the new point supersedes the remembered cell of its bin
+        histogram_points_counter(e_index[i], z_index[i])++;
+        if (histogram_points_counter(e_index[i], z_index[i]) == min_num_points_per_cell) {
+          memory.insert(e_index[i], z_index[i], toEigen(cloud.points[i]));
         }
       }
     }
   }
 
-  // combine with old cloud
-  for (const pcl::PointXYZI& xyzi : old_cloud) {
-    float distanceSq = (position - toEigen(xyzi)).squaredNorm();
-    if (distanceSq < sqr(max_sensor_range)) {
-      // adding older points if not expired and space is free according to new cloud
-      PolarPoint p_pol = cartesianToPolarHistogram(toEigen(xyzi), position);
-      PolarPoint p_pol_fcu = cartesianToPolarFCU(toEigen(xyzi), position);
-      p_pol_fcu.e -= pitch_fcu_frame_deg;
-      p_pol_fcu.z -= yaw_fcu_frame_deg;
-      wrapPolar(p_pol_fcu);
-      Eigen::Vector2i p_ind = polarToHistogramIndex(p_pol, ALPHA_RES / SCALE_FACTOR);
-
-      // only remember point if it's in a cell not previously populated by complete_cloud, as well as outside FOV and
-      // 'young' enough
-      if (histogram_points_counter(p_ind.y(), p_ind.x()) < min_num_points_per_cell && xyzi.intensity < max_age &&
-          !pointInsideFOV(fov, p_pol_fcu)) {
-        final_cloud.points.push_back(toXYZI(toEigen(xyzi), xyzi.intensity + elapsed_s));
-
-        // to indicate that this cell now has a point
-        histogram_points_counter(p_ind.y(), p_ind.x()) = min_num_points_per_cell;
-      }
-    }
+  final_cloud.points.clear();
+  final_cloud.points.reserve(memory.size());
+  for (const pcl::PointXYZI& cell : memory.cells().points) {
+    final_cloud.points.push_back(toXYZI(toEigen(cell), memory.age(cell)));
   }
 
-  final_cloud.header.stamp = complete_cloud[0].header.stamp;
-  final_cloud.header.frame_id = complete_cloud[0].header.frame_id;
+  // the fused cloud is as recent as the newest frame, clouds of cameras without a new frame have an empty header
+  const pcl::PointCloud<pcl::PointXYZ>* newest_cloud = &complete_cloud[0];
+  for (const auto& cloud : complete_cloud) {
+    if (cloud.header.stamp > newest_cloud->header.stamp) newest_cloud = &cloud;
+  }
+  final_cloud.header.stamp = newest_cloud->header.stamp;
+  final_cloud.header.frame_id = newest_cloud->header.frame_id;
   final_cloud.height = 1;
   final_cloud.width = final_cloud.points.size();
 }
@@ -80,14 +117,13 @@ void generateNewHistogram(Histogram& polar_histogram, const pcl::PointCloud<pcl:
                           const Eigen::Vector3f& position) {
   Eigen::MatrixXi counter(GRID_LENGTH_E, GRID_LENGTH_Z);
   counter.fill(0);
-  for (auto xyz : cropped_cloud) {
-    Eigen::Vector3f p = toEigen(xyz);
-    PolarPoint p_pol = cartesianToPolarHistogram(p, position);
-    float dist = p_pol.r;
-    Eigen::Vector2i p_ind = polarToHistogramIndex(p_pol, ALPHA_RES);
-
-    counter(p_ind.y(), p_ind.x()) += 1;
-    polar_histogram.set_dist(p_ind.y(), p_ind.x(), polar_histogram.get_dist(p_ind.y(), p_ind.x()) + dist);
+
+  Eigen::ArrayXi e_index, z_index;
+  Eigen::ArrayXf radius;
+  cartesianToHistogramIndex(cropped_cloud, position, ALPHA_RES, e_index, z_index, radius);
+  for (int i = 0; i < radius.size(); ++i) {
+    counter(e_index[i], z_index[i]) += 1;
+    polar_histogram.set_dist(e_index[i], z_index[i], polar_histogram.get_dist(e_index[i], z_index[i]) + radius[i]);
   }
 
   // Normalize and get mean in distance bins
@@ -109,14 +145,13 @@ void compressHistogramElevation(Histogram& new_hist, const Histogram& input_hist
   PolarPoint p_pol_upper(vertical_FOV_range_sensor / 2.0f, 0.0f, 0.0f);
   Eigen::Vector2i p_ind_lower = polarToHistogramIndex(p_pol_lower, ALPHA_RES);
   Eigen::Vector2i p_ind_upper = polarToHistogramIndex(p_pol_upper, ALPHA_RES);
+  const HistogramGeometry& geometry = HistogramGeometry::get();
 
   for (int e = p_ind_lower.y(); e <= p_ind_upper.y(); e++) {
     for (int z = 0; z < GRID_LENGTH_Z; z++) {
       if (input_hist.get_dist(e, z) > 0) {
         // check if inside vertical range
-        PolarPoint obstacle = histogramIndexToPolar(e, z, ALPHA_RES, input_hist.get_dist(e, z));
-        Eigen::Vector3f obstacle_cartesian = polarHistogramToCartesian(obstacle, position);
-        float height_difference = std::abs(position.z() - obstacle_cartesian.z());
+        float height_difference = std::abs(input_hist.get_dist(e, z) * geometry.sinElevation()(e));
         if (height_difference < vertical_cap &&
             (input_hist.get_dist(e, z) < new_hist.get_dist(0, z) || new_hist.get_dist(0, z) == 0.f))
           new_hist.set_dist(0, z, input_hist.get_dist(e, z));
@@ -128,14 +163,7 @@ void compressHistogramElevation(Histogram& new_hist, const Histogram& input_hist
 void getCostMatrix(const Histogram& histogram, const Eigen::Vector3f& goal, const Eigen::Vector3f& position,
                    const Eigen::Vector3f& velocity, const costParameters& cost_params, float smoothing_margin_degrees,
                    const Eigen::Vector3f& closest_pt, const float max_sensor_range, const float min_sensor_range,
-                   Eigen::MatrixXf& cost_matrix, std::vector<uint8_t>& image_data) {
-  Eigen::MatrixXf distance_matrix(GRID_LENGTH_E, GRID_LENGTH_Z);
-  distance_matrix.fill(NAN);
-
-  // reset cost matrix to zero
-  cost_matrix.resize(GRID_LENGTH_E, GRID_LENGTH_Z);
-  cost_matrix.fill(NAN);
-
+                   Eigen::MatrixXf& cost_matrix, std::vector<uint8_t>& image_data, bool generate_image) {
   // look if there are any obstacles in the goal direcion +-33deg azimuth, +-15deg elevation
   PolarPoint goal_polar = cartesianToPolarHistogram(goal, position);
   Eigen::Vector2i goal_index = polarToHistogramIndex(goal_polar, ALPHA_RES);
@@ -157,55 +185,70 @@ void getCostMatrix(const Histogram& histogram, const Eigen::Vector3f& goal, cons
     }
   }
 
-  // fill in cost matrix
-  for (int e_index = 0; e_index < GRID_LENGTH_E; e_index++) {
-    // determine how many bins at this elevation angle would be equivalent to
-    // a single bin at horizontal, then work in steps of that size
-    const float bin_width = std::cos(histogramIndexToPolar(e_index, 0, ALPHA_RES, 1).e * DEG_TO_RAD);
-    const int step_size = static_cast<int>(std::round(1 / bin_width));
-
-    for (int z_index = 0; z_index < GRID_LENGTH_Z; z_index += step_size) {
-      float obstacle_distance = histogram.get_dist(e_index, z_index);
-      PolarPoint p_pol = histogramIndexToPolar(e_index, z_index, ALPHA_RES, 1.0f);  // unit vector of current direction
-      std::pair<float, float> costs = costFunction(p_pol, obstacle_distance, goal, position, velocity, cost_params,
-                                                   closest_pt, is_obstacle_facing_goal);
-      cost_matrix(e_index, z_index) = costs.second;
-      distance_matrix(e_index, z_index) = costs.first;
-    }
-    if (step_size > 1) {
-      // horizontally interpolate all of the un-calculated values
-      int last_index = 0;
-      for (int z_index = step_size; z_index < GRID_LENGTH_Z; z_index += step_size) {
-        float other_costs_gradient = (cost_matrix(e_index, z_index) - cost_matrix(e_index, last_index)) / step_size;
-        float distance_cost_gradient =
-            (distance_matrix(e_index, z_index) - distance_matrix(e_index, last_index)) / step_size;
-        for (int i = 1; i < step_size; i++) {
-          cost_matrix(e_index, last_index + i) = cost_matrix(e_index, last_index) + other_costs_gradient * i;
-          distance_matrix(e_index, last_index + i) = distance_matrix(e_index, last_index) + distance_cost_gradient * i;
-        }
-        last_index = z_index;
-      }
-
-      // special case the last columns wrapping around back to 0
-      int clamped_z_scale = GRID_LENGTH_Z - last_index;
-      float other_costs_gradient = (cost_matrix(e_index, 0) - cost_matrix(e_index, last_index)) / clamped_z_scale;
-      float distance_cost_gradient =
-          (distance_matrix(e_index, 0) - distance_matrix(e_index, last_index)) / clamped_z_scale;
-
-      for (int i = 1; i < clamped_z_scale; i++) {
-        cost_matrix(e_index, last_index + i) = cost_matrix(e_index, last_index) + other_costs_gradient * i;
-        distance_matrix(e_index, last_index + i) = distance_matrix(e_index, last_index) + distance_cost_gradient * i;
-      }
-    }
-  }
+  Eigen::MatrixXf distance_matrix;
+  evaluateCostMatrix(histogram, goal, position, velocity, cost_params, closest_pt, is_obstacle_facing_goal,
+                     distance_matrix, cost_matrix);
 
   unsigned int smooth_radius = ceil(smoothing_margin_degrees / ALPHA_RES);
   smoothPolarMatrix(distance_matrix, smooth_radius);
 
-  generateCostImage(cost_matrix, distance_matrix, image_data);
+  if (generate_image) {
+    generateCostImage(cost_matrix, distance_matrix, image_data);
+  } else {
+    image_data.clear();
+  }
   cost_matrix = cost_matrix + distance_matrix;
 }
 
+void evaluateCostMatrix(const Histogram& histogram, const Eigen::Vector3f& goal, const Eigen::Vector3f& position,
+                        const Eigen::Vector3f& velocity, const costParameters& cost_params,
+                        const Eigen::Vector3f& closest_pt, const bool is_obstacle_facing_goal,
+                        Eigen::MatrixXf& distance_matrix, Eigen::MatrixXf& cost_matrix) {
+  // same terms as costFunction, with everything which does not depend on the bin computed once
+  const PolarPoint facing_goal = cartesianToPolarHistogram(goal, position);
+  const PolarPoint facing_line = cartesianToPolarHistogram(closest_pt, position);
+  const float goal_distance = (goal - position).norm();
+  const float weight = is_obstacle_facing_goal ? 0.f : 0.5f;  // yaw cost partition between line and goal
+
+  // increase the pitch cost starting at 5m from the goal (forcing the drone to goal altitude)
+  float pitch_cost_param = cost_params.pitch_cost_param;
+  if (goal_distance < 5.f) {
+    pitch_cost_param /= (0.2f * goal_distance) * (0.2f * goal_distance);
+  }
+
+  // elevation dependent terms, one entry per row
+  const HistogramGeometry& geometry = HistogramGeometry::get();
+  const HistogramGeometry::ElevationArray& cos_e = geometry.cosElevation();
+  const HistogramGeometry::ElevationArray& sin_e = geometry.sinElevation();
+  HistogramGeometry::ElevationArray pitch_cost;
+  for (int e_index = 0; e_index < GRID_LENGTH_E; e_index++) {
+    const float e = geometry.elevation(e_index);
+    pitch_cost(e_index) = pitch_cost_param * (e - facing_goal.e) * (e - facing_goal.e);
+  }
+
+  // azimuth dependent terms, one entry per column
+  const HistogramGeometry::AzimuthArray horizontal_velocity =
+      geometry.sinAzimuth() * velocity.x() + geometry.cosAzimuth() * velocity.y();
+  HistogramGeometry::AzimuthArray yaw_cost;
+  for (int z_index = 0; z_index < GRID_LENGTH_Z; z_index++) {
+    const float z = geometry.azimuth(z_index);
+    const float angle_diff = angleDifference(z, facing_goal.z);
+    const float angle_diff_to_line = angleDifference(z, facing_line.z);
+    yaw_cost(z_index) = (1.f - weight) * cost_params.yaw_cost_param * angle_diff * angle_diff +
+                        weight * cost_params.yaw_cost_param * angle_diff_to_line * angle_diff_to_line;
+  }
+
+  // velocity cost with the projection of the velocity on the unit direction of every bin
+  cost_matrix = cos_e.matrix() * horizontal_velocity.matrix().transpose();
+  cost_matrix.array() = cost_params.velocity_cost_param * (velocity.norm() - cost_matrix.array());
+  cost_matrix.colwise() += (pitch_cost - cost_params.velocity_cost_param * velocity.z() * sin_e).matrix();
+  cost_matrix.rowwise() += yaw_cost.matrix().transpose();
+
+  const Eigen::ArrayXXf obstacle_distance = histogram.distances().array();
+  const Eigen::ArrayXXf d = cost_params.obstacle_cost_param - obstacle_distance;
+  distance_matrix = (obstacle_distance > 0.f).select(5000.0f * (1.f + d / (1.f + d.square()).sqrt()), 0.f).matrix();
+}
+
 void generateCostImage(const Eigen::MatrixXf& cost_matrix, const Eigen::MatrixXf& distance_matrix,
                        std::vector<uint8_t>& image_data) {
   float max_val = std::max(cost_matrix.maxCoeff(), distance_matrix.maxCoeff());
@@ -229,57 +272,70 @@ int colorImageIndex(int e_ind, int z_ind, int color) {
 }
 
 void getBestCandidatesFromCostMatrix(const Eigen::MatrixXf& matrix, unsigned int number_of_candidates,
-                                     std::vector<candidateDirection>& candidate_vector) {
-  std::priority_queue<candidateDirection, std::vector<candidateDirection>, std::less<candidateDirection>> queue;
-
-  for (int row_index = 0; row_index < matrix.rows(); row_index++) {
-    for (int col_index = 0; col_index < matrix.cols(); col_index++) {
-      PolarPoint p_pol = histogramIndexToPolar(row_index, col_index, ALPHA_RES, 1.0);
-      float cost = matrix(row_index, col_index);
-      candidateDirection candidate(cost, p_pol.e, p_pol.z);
-
-      if (queue.size() < number_of_candidates) {
-        queue.push(candidate);
-      } else if (candidate < queue.top()) {
-        queue.push(candidate);
-        queue.pop();
+                                     std::vector<candidateDirection>& candidate_vector, float min_angle_deg) {
+  candidate_vector.clear();
+  const int n_cells = matrix.size();
+  const int n_wanted = std::min<int>(number_of_candidates, n_cells);
+  if (n_wanted <= 0) return;
+
+  // order the raw column major cost buffer by cost, NaN counts as the most expensive and ties go to the lower index
+  const float* cost = matrix.data();
+  auto cheaper = [cost](int a, int b) {
+    const float cost_a = std::isnan(cost[a]) ? INFINITY : cost[a];
+    const float cost_b = std::isnan(cost[b]) ? INFINITY : cost[b];
+    return cost_a < cost_b || (cost_a == cost_b && a < b);
+  };
+  std::vector<int> cells(n_cells);
+  std::iota(cells.begin(), cells.end(), 0);
+
+  const HistogramGeometry& geometry = HistogramGeometry::get();
+  const float cos_min_angle = std::cos(min_angle_deg * DEG_TO_RAD);
+  std::vector<Eigen::Vector3f> accepted_directions;
+  candidate_vector.reserve(n_wanted);
+
+  // select the cheapest cells in growing chunks, without suppression the first chunk is all that is needed
+  int sorted = 0;
+  int chunk_end = min_angle_deg > 0.f ? std::min(4 * n_wanted, n_cells) : n_wanted;
+  while (static_cast<int>(candidate_vector.size()) < n_wanted && sorted < n_cells) {
+    std::nth_element(cells.begin() + sorted, cells.begin() + chunk_end - 1, cells.end(), cheaper);
+    std::sort(cells.begin() + sorted, cells.begin() + chunk_end, cheaper);
+
+    for (int i = sorted; i < chunk_end && static_cast<int>(candidate_vector.size()) < n_wanted; i++) {
+      const int row_index = cells[i] % matrix.rows();
+      const int col_index = cells[i] / matrix.rows();
+
+      if (min_angle_deg > 0.f) {
+        // angular non-maximum suppression, cheaper accepted directions suppress their neighbourhood
+        const Eigen::Vector3f direction = geometry.direction(row_index, col_index);
+        bool suppressed = false;
+        for (const Eigen::Vector3f& accepted : accepted_directions) {
+          if (direction.dot(accepted) > cos_min_angle) {
+            suppressed = true;
+            break;
+          }
+        }
+        if (suppressed) continue;
+        accepted_directions.push_back(direction);
       }
+
+      candidate_vector.emplace_back(cost[cells[i]], geometry.elevation(row_index), geometry.azimuth(col_index));
     }
+    sorted = chunk_end;
+    chunk_end = std::min(2 * chunk_end, n_cells);
   }
-  // copy queue to vector and change order such that lowest cost is at the
-  // front
-  candidate_vector.clear();
-  candidate_vector.reserve(queue.size());
-  while (!queue.empty()) {
-    candidate_vector.push_back(queue.top());
-    queue.pop();
-  }
-  std::reverse(candidate_vector.begin(), candidate_vector.end());
 }
 
 void smoothPolarMatrix(Eigen::MatrixXf& matrix, unsigned int smoothing_radius) {
   // pad matrix by smoothing radius respecting all wrapping rules
   Eigen::MatrixXf matrix_padded;
   padPolarMatrix(matrix, smoothing_radius, matrix_padded);
-  Eigen::ArrayXf kernel1d = getConicKernel(smoothing_radius);
-
-  Eigen::ArrayXf temp_col(matrix_padded.rows());
-  for (int col_index = 0; col_index < matrix_padded.cols(); col_index++) {
-    temp_col = matrix_padded.col(col_index);
-    for (int row_index = 0; row_index < matrix.rows(); row_index++) {
-      float smooth_val = (temp_col.segment(row_index, 2 * smoothing_radius + 1) * kernel1d).sum();
-      matrix_padded(row_index + smoothing_radius, col_index) = smooth_val;
-    }
-  }
 
-  Eigen::ArrayXf temp_row(matrix_padded.cols());
-  for (int row_index = 0; row_index < matrix.rows(); row_index++) {
-    temp_row = matrix_padded.row(row_index + smoothing_radius);
-    for (int col_index = 0; col_index < matrix.cols(); col_index++) {
-      float smooth_val = (temp_row.segment(col_index, 2 * smoothing_radius + 1) * kernel1d).sum();
-      matrix(row_index, col_index) = smooth_val;
-    }
-  }
+  // smooth along the elevation for all columns including the azimuth padding, then along the azimuth
+  Eigen::MatrixXf smoothed_columns;
+  conicFilterColumns(matrix_padded, smoothing_radius, smoothed_columns);
+  Eigen::MatrixXf smoothed_rows;
+  conicFilterColumns(smoothed_columns.transpose(), smoothing_radius, smoothed_rows);
+  matrix = smoothed_rows.transpose();
 }
 
 Eigen::ArrayXf getConicKernel(int radius) {
@@ -0,0 +1,23 @@
+#include "local_planner/pointcloud_fusion.h"
+
+#include "local_planner/planner_functions.h"
+
+namespace avoidance {
+
+void PointcloudFusion::dynamicReconfigureSetParams(const avoidance::LocalPlannerNodeConfig& config) {
+  min_sensor_range_ = static_cast<float>(config.min_sensor_range_);
+  max_sensor_range_ = static_cast<float>(config.max_sensor_range_);
+  max_point_age_s_ = static_cast<float>(config.max_point_age_s_);
+  min_num_points_per_cell_ = config.min_num_points_per_cell_;
+}
+
+void PointcloudFusion::fuse(pcl::PointCloud<pcl::PointXYZI>& fused_cloud,
+                            const std::vector<pcl::PointCloud<pcl::PointXYZ>>& clouds, const std::vector<FOV>& fov,
+                            const Eigen::Vector3f& position, float yaw_fcu_frame_deg, float pitch_fcu_frame_deg) {
+  float elapsed_since_last_processing = static_cast<float>((ros::Time::now() - last_fusion_time_).toSec());
+  processPointcloud(fused_cloud, obstacle_memory_, fov_mask_, clouds, fov, yaw_fcu_frame_deg, pitch_fcu_frame_deg,
+                    position, min_sensor_range_, max_sensor_range_, max_point_age_s_, elapsed_since_last_processing,
+                    min_num_points_per_cell_);
+  last_fusion_time_ = ros::Time::now();
+}
+}
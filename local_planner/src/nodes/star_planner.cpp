@@ -6,13 +6,18 @@
 
 #include <ros/console.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
 namespace avoidance {
 
-StarPlanner::StarPlanner() {}
+StarPlanner::StarPlanner() : worker_pool_(new WorkerPool()) {}
 
 // set parameters changed by dynamic rconfigure
 void StarPlanner::dynamicReconfigureSetStarParams(const avoidance::LocalPlannerNodeConfig& config, uint32_t level) {
   children_per_node_ = config.children_per_node_;
+  children_min_angle_deg_ = static_cast<float>(config.children_min_angle_deg_);
   n_expanded_nodes_ = config.n_expanded_nodes_;
   tree_node_distance_ = static_cast<float>(config.tree_node_distance_);
   max_path_length_ = static_cast<float>(config.max_sensor_range_);
@@ -20,6 +25,14 @@ void StarPlanner::dynamicReconfigureSetStarParams(const avoidance::LocalPlannerN
   tree_heuristic_weight_ = static_cast<float>(config.tree_heuristic_weight_);
   max_sensor_range_ = static_cast<float>(config.max_sensor_range_);
   min_sensor_range_ = static_cast<float>(config.min_sensor_range_);
+  expansion_batch_size_ = config.expansion_batch_size_;
+  reuse_tree_ = config.reuse_tree_;
+  tree_time_budget_ms_ = static_cast<float>(config.tree_time_budget_ms_);
+  tree_reusable_ = false;
+
+  if (worker_pool_->size() != static_cast<size_t>(config.expansion_threads_)) {
+    worker_pool_.reset(new WorkerPool(std::max(config.expansion_threads_, 1)));
+  }
 }
 
 void StarPlanner::setParams(costParameters cost_params) { cost_params_ = cost_params; }
@@ -31,7 +44,10 @@ void StarPlanner::setPose(const Eigen::Vector3f& pos, const Eigen::Vector3f& vel
 
 void StarPlanner::setGoal(const Eigen::Vector3f& goal) { goal_ = goal; }
 
-void StarPlanner::setPointcloud(const pcl::PointCloud<pcl::PointXYZI>& cloud) { cloud_ = cloud; }
+void StarPlanner::setPointcloud(const pcl::PointCloud<pcl::PointXYZI>& cloud) {
+  // a radius query then visits at most 9 voxels along each axis
+  cloud_index_.build(cloud, std::max(max_sensor_range_ / 4.f, 0.1f));
+}
 
 void StarPlanner::setClosestPointOnLine(const Eigen::Vector3f& closest_pt) { closest_pt_ = closest_pt; }
 
@@ -39,91 +55,221 @@ float StarPlanner::treeHeuristicFunction(int node_number) const {
   return (goal_ - tree_[node_number].getPosition()).norm() * tree_heuristic_weight_;
 }
 
-void StarPlanner::buildLookAheadTree() {
-  std::clock_t start_time = std::clock();
+void StarPlanner::computeNodeCandidates(int node_number, ExpansionScratch& scratch,
+                                        std::vector<candidateDirection>& candidates) const {
+  Eigen::Vector3f origin_position = tree_[node_number].getPosition();
+  Eigen::Vector3f origin_velocity = tree_[node_number].getVelocity();
 
-  Histogram histogram(ALPHA_RES);
-  std::vector<uint8_t> cost_image_data;
-  std::vector<candidateDirection> candidate_vector;
-  Eigen::MatrixXf cost_matrix;
+  scratch.histogram.setZero();
+  cloud_index_.radiusSearch(origin_position, max_sensor_range_, scratch.node_cloud);
+  generateNewHistogram(scratch.histogram, scratch.node_cloud, origin_position);
 
-  bool is_expanded_node = true;
+  // calculate candidates
+  candidates.clear();
+  getCostMatrix(scratch.histogram, goal_, origin_position, origin_velocity, cost_params_, smoothing_margin_degrees_,
+                closest_pt_, max_sensor_range_, min_sensor_range_, scratch.cost_matrix, scratch.cost_image_data,
+                false);
+  getBestCandidatesFromCostMatrix(scratch.cost_matrix, children_per_node_, candidates, children_min_angle_deg_);
+}
 
-  tree_.clear();
-  closed_set_.clear();
+void StarPlanner::selectNodesToExpand(int max_nodes, std::vector<int>& batch) {
+  batch.clear();
+  while (static_cast<int>(batch.size()) < max_nodes && !open_set_.empty()) {
+    batch.push_back(open_set_.pop());
+  }
+}
 
-  // insert first node
-  tree_.push_back(TreeNode(0, position_, velocity_));
-  tree_.back().setCosts(treeHeuristicFunction(0), treeHeuristicFunction(0));
-
-  int origin = 0;
-  for (int n = 0; n < n_expanded_nodes_ && is_expanded_node; n++) {
-    Eigen::Vector3f origin_position = tree_[origin].getPosition();
-    Eigen::Vector3f origin_velocity = tree_[origin].getVelocity();
-
-    histogram.setZero();
-    generateNewHistogram(histogram, cloud_, origin_position);
-
-    // calculate candidates
-    cost_matrix.fill(0.f);
-    cost_image_data.clear();
-    candidate_vector.clear();
-    getCostMatrix(histogram, goal_, origin_position, origin_velocity, cost_params_, smoothing_margin_degrees_,
-                  closest_pt_, max_sensor_range_, min_sensor_range_, cost_matrix, cost_image_data);
-    getBestCandidatesFromCostMatrix(cost_matrix, children_per_node_, candidate_vector);
-
-    // add candidates as nodes
-    if (candidate_vector.empty()) {
-      tree_[origin].total_cost_ = HUGE_VAL;
-    } else {
-      // insert new nodes
-      int children = 0;
-      for (candidateDirection candidate : candidate_vector) {
-        PolarPoint candidate_polar = candidate.toPolar(tree_node_distance_);
-        Eigen::Vector3f node_location = polarHistogramToCartesian(candidate_polar, origin_position);
-        Eigen::Vector3f node_velocity = node_location - origin_position;  // todo: simulate!
-
-        // check if another close node has been added
-        int close_nodes = 0;
-        for (size_t i = 0; i < tree_.size(); i++) {
-          float dist = (tree_[i].getPosition() - node_location).norm();
-          if (dist < 0.2f) {
-            close_nodes++;
-            break;
-          }
-        }
+void StarPlanner::registerTreeNode(int node_number) {
+  const TreeNode& node = tree_[node_number];
+  node_grid_[voxelKey(voxelCoordinates(node.getPosition(), min_node_distance_))].push_back(node_number);
+
+  float node_distance = (node.getPosition() - position_).norm();
+  if (!node.closed_ && node.total_cost_ < HUGE_VAL && node_distance < max_path_length_) {
+    open_set_.push(node_number, node.total_cost_);
+  }
+}
 
-        if (children < children_per_node_ && close_nodes == 0) {
-          tree_.push_back(TreeNode(origin, node_location, node_velocity));
-          float h = treeHeuristicFunction(tree_.size() - 1);
-          tree_.back().heuristic_ = h;
-          tree_.back().total_cost_ = tree_[origin].total_cost_ - tree_[origin].heuristic_ + candidate.cost + h;
-          tree_.back().depth_ = tree_[origin].depth_ + 1;
-          children++;
+bool StarPlanner::isCloseToTreeNode(const Eigen::Vector3f& position) const {
+  // all nodes closer than the voxel size are in the neighbouring voxels
+  const Eigen::Vector3i voxel = voxelCoordinates(position, min_node_distance_);
+  for (int x = -1; x <= 1; x++) {
+    for (int y = -1; y <= 1; y++) {
+      for (int z = -1; z <= 1; z++) {
+        auto it = node_grid_.find(voxelKey(voxel + Eigen::Vector3i(x, y, z)));
+        if (it == node_grid_.end()) continue;
+        for (int i : it->second) {
+          if ((tree_[i].getPosition() - position).norm() < min_node_distance_) {
+            return true;
+          }
         }
       }
     }
+  }
+  return false;
+}
+
+bool StarPlanner::isEdgeBlocked(const Eigen::Vector3f& from, const Eigen::Vector3f& to,
+                                pcl::PointCloud<pcl::PointXYZI>& scratch) const {
+  const Eigen::Vector3f edge = to - from;
+  const float length = edge.norm();
+  // the bin boundaries are not aligned with the edge, so a whole bin width is used as margin
+  const float cos_bin_width = std::cos(static_cast<float>(ALPHA_RES) * DEG_TO_RAD);
+
+  cloud_index_.radiusSearch(from, length, scratch);
+  for (const pcl::PointXYZI& point : scratch.points) {
+    const Eigen::Vector3f direction = toEigen(point) - from;
+    if (edge.dot(direction) >= cos_bin_width * length * direction.norm()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool StarPlanner::reusePreviousTree() {
+  // the edge costs of the previous tree were computed for its goal
+  if (!reuse_tree_ || !tree_reusable_ || tree_.empty() || !((goal_ - tree_goal_).norm() < tree_node_distance_)) {
+    return false;
+  }
 
-    closed_set_.push_back(origin);
-    tree_[origin].closed_ = true;
-
-    // find best node to continue
-    float minimal_cost = HUGE_VAL;
-    is_expanded_node = false;
-    for (size_t i = 0; i < tree_.size(); i++) {
-      if (!(tree_[i].closed_)) {
-        float node_distance = (tree_[i].getPosition() - position_).norm();
-        if (tree_[i].total_cost_ < minimal_cost && node_distance < max_path_length_) {
-          minimal_cost = tree_[i].total_cost_;
-          origin = i;
-          is_expanded_node = true;
+  int root = 0;
+  float root_distance = INFINITY;
+  for (size_t i = 0; i < tree_.size(); i++) {
+    float distance = (tree_[i].getPosition() - position_).norm();
+    if (distance < root_distance) {
+      root_distance = distance;
+      root = i;
+    }
+  }
+  const float root_cost = tree_[root].total_cost_ - tree_[root].heuristic_;
+  if (root_distance > tree_node_distance_ || !(tree_[root].total_cost_ < HUGE_VAL)) {
+    return false;
+  }
+
+  // children are stored after their parents, so a single pass visits the branches of the new root top down
+  pcl::PointCloud<pcl::PointXYZI>& scratch = scratch_.front().node_cloud;
+  std::vector<int> new_index(tree_.size(), -1);
+  std::vector<TreeNode> tree;
+  tree.reserve(tree_.size() - root);
+  tree.push_back(TreeNode(0, position_, velocity_));
+  new_index[root] = 0;
+
+  for (size_t i = root + 1; i < tree_.size(); i++) {
+    const int parent = new_index[tree_[i].origin_];
+    if (parent < 0) continue;
+
+    const Eigen::Vector3f parent_position = tree[parent].getPosition();
+    const Eigen::Vector3f node_position = tree_[i].getPosition();
+    if ((node_position - parent_position).norm() < min_node_distance_ ||
+        isEdgeBlocked(parent_position, node_position, scratch)) {
+      // drop the branch, its parent has to look for other directions
+      tree[parent].closed_ = false;
+      continue;
+    }
+
+    new_index[i] = tree.size();
+    tree.push_back(tree_[i]);
+    tree.back().origin_ = parent;
+    tree.back().depth_ = tree[parent].depth_ + 1;
+    // cost from the new root, the heuristic is added once the tree is in place
+    tree.back().total_cost_ -= tree.back().heuristic_ + root_cost;
+  }
+  tree_.swap(tree);
+
+  closed_set_.clear();
+  open_set_.clear();
+  node_grid_.clear();
+  tree_[0].setCosts(treeHeuristicFunction(0), treeHeuristicFunction(0));
+  node_grid_[voxelKey(voxelCoordinates(position_, min_node_distance_))].push_back(0);
+  for (size_t i = 1; i < tree_.size(); i++) {
+    tree_[i].heuristic_ = treeHeuristicFunction(i);
+    tree_[i].total_cost_ += tree_[i].heuristic_;
+    if (tree_[i].closed_) closed_set_.push_back(i);
+    registerTreeNode(i);
+  }
+  return true;
+}
+
+void StarPlanner::buildLookAheadTree() {
+  std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+  auto elapsedMs = [&start_time]() {
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+  };
+
+  scratch_.resize(worker_pool_->size());
+  batch_candidates_.resize(std::max(expansion_batch_size_, 1));
+
+  if (!reusePreviousTree()) {
+    tree_.clear();
+    closed_set_.clear();
+    open_set_.clear();
+    node_grid_.clear();
+
+    // insert first node, it is expanded directly
+    tree_.push_back(TreeNode(0, position_, velocity_));
+    tree_.back().setCosts(treeHeuristicFunction(0), treeHeuristicFunction(0));
+    node_grid_[voxelKey(voxelCoordinates(position_, min_node_distance_))].push_back(0);
+  }
+  const size_t reused_nodes = tree_.size() - 1;
+
+  // the root is always expanded, reused nodes which are still closed count towards the expansion budget
+  std::vector<int> batch;
+  if (n_expanded_nodes_ > 0) batch.push_back(0);
+
+  const int n_reused_expanded = closed_set_.size();
+  int n_expanded = n_reused_expanded;
+  float batch_start_ms = 0.f;
+  while (!batch.empty()) {
+    // the histograms and cost matrices of the batch are independent, compute them concurrently
+    worker_pool_->run(batch.size(), [&](size_t i, size_t worker) {
+      computeNodeCandidates(batch[i], scratch_[worker], batch_candidates_[i]);
+    });
+
+    // add candidates as nodes, in batch order so the tree does not depend on the thread count
+    for (size_t b = 0; b < batch.size(); b++) {
+      int origin = batch[b];
+      Eigen::Vector3f origin_position = tree_[origin].getPosition();
+      const std::vector<candidateDirection>& candidate_vector = batch_candidates_[b];
+
+      if (candidate_vector.empty()) {
+        tree_[origin].total_cost_ = HUGE_VAL;
+      } else {
+        // insert new nodes
+        int children = 0;
+        for (candidateDirection candidate : candidate_vector) {
+          PolarPoint candidate_polar = candidate.toPolar(tree_node_distance_);
+          Eigen::Vector3f node_location = polarHistogramToCartesian(candidate_polar, origin_position);
+          Eigen::Vector3f node_velocity = node_location - origin_position;  // todo: simulate!
+
+          // check if another close node has been added
+          if (children < children_per_node_ && !isCloseToTreeNode(node_location)) {
+            tree_.push_back(TreeNode(origin, node_location, node_velocity));
+            float h = treeHeuristicFunction(tree_.size() - 1);
+            tree_.back().heuristic_ = h;
+            tree_.back().total_cost_ = tree_[origin].total_cost_ - tree_[origin].heuristic_ + candidate.cost + h;
+            tree_.back().depth_ = tree_[origin].depth_ + 1;
+            registerTreeNode(tree_.size() - 1);
+            children++;
+          }
         }
       }
+
+      closed_set_.push_back(origin);
+      tree_[origin].closed_ = true;
+    }
+    n_expanded += batch.size();
+
+    // stop if the next batch is expected to take as long as this one and would not finish in time
+    if (tree_time_budget_ms_ > 0.f) {
+      const float now_ms = elapsedMs();
+      const float batch_ms = now_ms - batch_start_ms;
+      batch_start_ms = now_ms;
+      if (now_ms + batch_ms > tree_time_budget_ms_) break;
     }
 
-    cost_image_data.clear();
-    candidate_vector.clear();
+    // find best nodes to continue
+    selectNodesToExpand(std::min(expansion_batch_size_, n_expanded_nodes_ - n_expanded), batch);
   }
+  expanded_nodes_ = n_expanded - n_reused_expanded;
 
   // find best node to follow, taking into account A* completion
   int max_depth = 0;
@@ -146,9 +292,15 @@ void StarPlanner::buildLookAheadTree() {
   }
   path_node_positions_.push_back(tree_[0].getPosition());
 
-  ROS_INFO("\033[0;35m[SP]Tree (%lu nodes, %lu path nodes, %lu expanded) calculated in %2.2fms.\033[0m", tree_.size(),
-           path_node_positions_.size(), closed_set_.size(),
-           static_cast<double>((std::clock() - start_time) / static_cast<double>(CLOCKS_PER_SEC / 1000)));
+  tree_goal_ = goal_;
+  tree_reusable_ = true;
+
+  const float build_time_ms = elapsedMs();
+  time_slack_ms_ = tree_time_budget_ms_ > 0.f ? tree_time_budget_ms_ - build_time_ms : NAN;
+
+  ROS_INFO("\033[0;35m[SP]Tree (%lu nodes, %lu reused, %lu path nodes, %lu expanded) calculated in %2.2fms.\033[0m",
+           tree_.size(), reused_nodes, path_node_positions_.size(), closed_set_.size(),
+           static_cast<double>(build_time_ms));
 
 #ifndef DISABLE_SIMULATION  // For large trees, this could be very slow!
   for (int j = 0; j < path_node_positions_.size(); j++) {
@@ -0,0 +1,76 @@
+#include "local_planner/voxel_index.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace avoidance {
+
+void VoxelIndex::build(const pcl::PointCloud<pcl::PointXYZI>& cloud, float voxel_size) {
+  voxel_size_ = voxel_size;
+  voxels_.clear();
+
+  std::vector<std::pair<int64_t, size_t>> keys;
+  keys.reserve(cloud.points.size());
+  for (size_t i = 0; i < cloud.points.size(); ++i) {
+    const pcl::PointXYZI& p = cloud.points[i];
+    if (!std::isfinite(p.x) || !std::isfinite(p.y) || !std::isfinite(p.z)) continue;
+    keys.emplace_back(voxelKey(voxelCoordinates(Eigen::Vector3f(p.x, p.y, p.z), voxel_size_)), i);
+  }
+  std::sort(keys.begin(), keys.end());
+
+  points_.points.resize(keys.size());
+  voxels_.reserve(keys.size());
+  size_t begin = 0;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    points_.points[i] = cloud.points[keys[i].second];
+    if (i + 1 == keys.size() || keys[i + 1].first != keys[i].first) {
+      voxels_.emplace(keys[i].first, std::make_pair(begin, i + 1));
+      begin = i + 1;
+    }
+  }
+  points_.header = cloud.header;
+  points_.height = 1;
+  points_.width = points_.points.size();
+}
+
+void VoxelIndex::radiusSearch(const Eigen::Vector3f& center, float radius,
+                              pcl::PointCloud<pcl::PointXYZI>& result) const {
+  result.points.clear();
+  result.header = points_.header;
+  const float radius_sq = radius * radius;
+  const Eigen::Vector3i min_voxel = voxelCoordinates(center - Eigen::Vector3f::Constant(radius), voxel_size_);
+  const Eigen::Vector3i max_voxel = voxelCoordinates(center + Eigen::Vector3f::Constant(radius), voxel_size_);
+
+  for (int x = min_voxel.x(); x <= max_voxel.x(); ++x) {
+    for (int y = min_voxel.y(); y <= max_voxel.y(); ++y) {
+      for (int z = min_voxel.z(); z <= max_voxel.z(); ++z) {
+        // distances from the center to the closest and farthest point of the voxel
+        const Eigen::Array3f lower = Eigen::Array3f(x, y, z) * voxel_size_ - center.array();
+        const Eigen::Array3f upper = lower + voxel_size_;
+        const float closest_sq = (lower.max(0.f) + (-upper).max(0.f)).square().sum();
+        if (closest_sq > radius_sq) continue;
+
+        auto it = voxels_.find(voxelKey(Eigen::Vector3i(x, y, z)));
+        if (it == voxels_.end()) continue;
+
+        const float farthest_sq = lower.abs().max(upper.abs()).square().sum();
+        const size_t begin = it->second.first;
+        const size_t end = it->second.second;
+        if (farthest_sq <= radius_sq) {
+          result.points.insert(result.points.end(), points_.points.begin() + begin, points_.points.begin() + end);
+        } else {
+          for (size_t i = begin; i < end; ++i) {
+            const pcl::PointXYZI& p = points_.points[i];
+            if ((Eigen::Vector3f(p.x, p.y, p.z) - center).squaredNorm() <= radius_sq) {
+              result.points.push_back(p);
+            }
+          }
+        }
+      }
+    }
+  }
+  result.height = 1;
+  result.width = result.points.size();
+}
+}
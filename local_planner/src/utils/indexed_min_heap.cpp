@@ -0,0 +1,84 @@
+#include "local_planner/indexed_min_heap.h"
+
+namespace avoidance {
+
+void IndexedMinHeap::clear() {
+  for (const auto& entry : heap_) {
+    position_[entry.second] = -1;
+  }
+  heap_.clear();
+}
+
+void IndexedMinHeap::push(int id, float key) {
+  if (id >= static_cast<int>(position_.size())) {
+    position_.resize(id + 1, -1);
+  }
+
+  if (position_[id] >= 0) {
+    const size_t i = position_[id];
+    const float old_key = heap_[i].first;
+    heap_[i].first = key;
+    if (key < old_key) {
+      siftUp(i);
+    } else {
+      siftDown(i);
+    }
+    return;
+  }
+
+  heap_.emplace_back(key, id);
+  position_[id] = heap_.size() - 1;
+  siftUp(heap_.size() - 1);
+}
+
+int IndexedMinHeap::pop() {
+  const int id = heap_.front().second;
+  erase(id);
+  return id;
+}
+
+void IndexedMinHeap::erase(int id) {
+  if (!contains(id)) return;
+
+  const size_t i = position_[id];
+  const size_t last = heap_.size() - 1;
+  if (i != last) {
+    swapEntries(i, last);
+  }
+  heap_.pop_back();
+  position_[id] = -1;
+
+  if (i < heap_.size()) {
+    siftUp(i);
+    siftDown(i);
+  }
+}
+
+void IndexedMinHeap::swapEntries(size_t a, size_t b) {
+  std::swap(heap_[a], heap_[b]);
+  position_[heap_[a].second] = a;
+  position_[heap_[b].second] = b;
+}
+
+void IndexedMinHeap::siftUp(size_t i) {
+  while (i > 0) {
+    const size_t parent = (i - 1) / 2;
+    if (!before(i, parent)) break;
+    swapEntries(i, parent);
+    i = parent;
+  }
+}
+
+void IndexedMinHeap::siftDown(size_t i) {
+  while (true) {
+    const size_t left = 2 * i + 1;
+    const size_t right = left + 1;
+    size_t smallest = i;
+    if (left < heap_.size() && before(left, smallest)) smallest = left;
+    if (right < heap_.size() && before(right, smallest)) smallest = right;
+    if (smallest == i) break;
+    swapEntries(i, smallest);
+    i = smallest;
+  }
+}
+}
@@ -0,0 +1,112 @@
+#include "local_planner/stage_timer.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace avoidance {
+
+constexpr size_t StageTimer::DEFAULT_WINDOW_SIZE;
+
+const char* stageName(PlannerStage stage) {
+  switch (stage) {
+    case PlannerStage::cloud_receive:
+      return "cloud_receive";
+    case PlannerStage::transform:
+      return "transform";
+    case PlannerStage::process_pointcloud:
+      return "process_pointcloud";
+    case PlannerStage::histogram:
+      return "histogram";
+    case PlannerStage::cost_matrix:
+      return "cost_matrix";
+    case PlannerStage::tree:
+      return "tree";
+    case PlannerStage::waypoint:
+      return "waypoint";
+    case PlannerStage::publish:
+      return "publish";
+    default:
+      return "unknown";
+  }
+}
+
+StageTimer::Scope::Scope(StageTimer& timer, PlannerStage stage)
+    : timer_{timer.isEnabled() ? &timer : nullptr}, stage_{stage} {
+  if (timer_) start_ = Clock::now();
+}
+
+StageTimer::Scope::Scope(Scope&& other) : timer_{other.timer_}, stage_{other.stage_}, start_{other.start_} {
+  other.timer_ = nullptr;
+}
+
+StageTimer::Scope::~Scope() {
+  if (timer_) {
+    timer_->addSample(stage_, std::chrono::duration<float, std::milli>(Clock::now() - start_).count());
+  }
+}
+
+StageTimer::StageTimer(size_t window_size) { setWindowSize(window_size); }
+
+void StageTimer::setEnabled(bool enabled) {
+  if (enabled && !enabled_.exchange(true)) {
+    reset();
+  } else if (!enabled) {
+    enabled_ = false;
+  }
+}
+
+void StageTimer::addSample(PlannerStage stage, float duration_ms) {
+  if (!enabled_ || !std::isfinite(duration_ms)) return;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  Window& window = windows_[static_cast<size_t>(stage)];
+  window.samples[window.next] = duration_ms;
+  window.next = (window.next + 1) % window.samples.size();
+  window.count = std::min(window.count + 1, window.samples.size());
+}
+
+StageStatistics StageTimer::getStatistics(PlannerStage stage) const {
+  std::vector<float> samples;
+  StageStatistics stats;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const Window& window = windows_[static_cast<size_t>(stage)];
+    stats.samples = window.count;
+    samples.assign(window.samples.begin(), window.samples.begin() + window.count);
+  }
+  if (stats.samples == 0) return stats;
+
+  auto begin = samples.begin();
+  auto end = samples.begin() + stats.samples;
+  float sum = 0.f;
+  stats.min_ms = *begin;
+  for (auto it = begin; it != end; ++it) {
+    sum += *it;
+    stats.min_ms = std::min(stats.min_ms, *it);
+  }
+  stats.mean_ms = sum / static_cast<float>(stats.samples);
+
+  // nearest rank percentile
+  size_t rank = static_cast<size_t>(std::ceil(0.99f * static_cast<float>(stats.samples))) - 1;
+  std::nth_element(begin, begin + rank, end);
+  stats.p99_ms = begin[rank];
+  return stats;
+}
+
+void StageTimer::reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Window& window : windows_) {
+    window.count = 0;
+    window.next = 0;
+  }
+}
+
+void StageTimer::setWindowSize(size_t window_size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (Window& window : windows_) {
+    window.samples.assign(std::max<size_t>(window_size, 1), 0.f);
+    window.count = 0;
+    window.next = 0;
+  }
+}
+}
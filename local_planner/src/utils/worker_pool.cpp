@@ -0,0 +1,71 @@
+#include "local_planner/worker_pool.h"
+
+namespace avoidance {
+
+WorkerPool::WorkerPool(size_t num_workers) {
+  for (size_t worker = 1; worker < num_workers; ++worker) {
+    threads_.emplace_back(&WorkerPool::workerThread, this, worker);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    should_exit_ = true;
+  }
+  start_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void WorkerPool::run(size_t num_tasks, const Task& task) {
+  if (threads_.empty() || num_tasks < 2) {
+    for (size_t i = 0; i < num_tasks; ++i) {
+      task(i, 0);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    num_tasks_ = num_tasks;
+    next_task_ = 0;
+    busy_workers_ = threads_.size();
+    ++generation_;
+  }
+  start_cv_.notify_all();
+
+  executeTasks(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_cv_.wait(lock, [this] { return busy_workers_ == 0; });
+  task_ = nullptr;
+}
+
+void WorkerPool::workerThread(size_t worker) {
+  size_t last_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_cv_.wait(lock, [&] { return should_exit_ || generation_ != last_generation; });
+      if (should_exit_) return;
+      last_generation = generation_;
+    }
+
+    executeTasks(worker);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--busy_workers_ == 0) {
+      done_cv_.notify_one();
+    }
+  }
+}
+
+void WorkerPool::executeTasks(size_t worker) {
+  for (size_t i = next_task_++; i < num_tasks_; i = next_task_++) {
+    (*task_)(i, worker);
+  }
+}
+}
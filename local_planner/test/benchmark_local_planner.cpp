@@ -0,0 +1,327 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "../include/local_planner/obstacle_memory.h"
+#include "../include/local_planner/planner_functions.h"
+#include "../include/local_planner/star_planner.h"
+#include "../include/local_planner/tree_node.h"
+#include "avoidance/common.h"
+#include "avoidance/concurrent_transform_buffer.h"
+#include "avoidance/transform_buffer.h"
+
+// Micro-benchmarks of the avoidance and local planner kernels on synthetic
+// data. Run with --benchmark_format=json or --benchmark_out=<file> to get
+// machine readable results which can be compared across releases.
+
+using namespace avoidance;
+
+namespace {
+
+const Eigen::Vector3f kPosition(0.f, 0.f, 4.f);
+const Eigen::Vector3f kVelocity(1.f, 0.5f, 0.f);
+const Eigen::Vector3f kGoal(10.f, 40.f, 4.f);
+
+// random points in a box in front of the vehicle, roughly what a depth camera sees
+pcl::PointCloud<pcl::PointXYZ> makeCloud(size_t num_points, float nan_ratio = 0.f) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> lateral(-6.f, 6.f);
+  std::uniform_real_distribution<float> depth(0.5f, 12.f);
+  std::uniform_real_distribution<float> height(0.f, 8.f);
+  std::uniform_real_distribution<float> unit(0.f, 1.f);
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  cloud.points.reserve(num_points);
+  for (size_t i = 0; i < num_points; i++) {
+    if (unit(generator) < nan_ratio) {
+      cloud.points.emplace_back(NAN, NAN, NAN);
+    } else {
+      cloud.points.emplace_back(lateral(generator), depth(generator), height(generator));
+    }
+  }
+  cloud.width = cloud.points.size();
+  cloud.height = 1;
+  return cloud;
+}
+
+pcl::PointCloud<pcl::PointXYZI> makeCloudXYZI(size_t num_points) {
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  for (const pcl::PointXYZ& p : makeCloud(num_points).points) cloud.points.push_back(toXYZI(p, 0.f));
+  cloud.width = cloud.points.size();
+  cloud.height = 1;
+  return cloud;
+}
+
+Histogram makeHistogram(size_t num_points) {
+  Histogram histogram(ALPHA_RES);
+  generateNewHistogram(histogram, makeCloudXYZI(num_points), kPosition);
+  return histogram;
+}
+
+Eigen::MatrixXf makeCostMatrix() {
+  Eigen::MatrixXf cost_matrix;
+  std::vector<uint8_t> image_data;
+  getCostMatrix(makeHistogram(10000), kGoal, kPosition, kVelocity, costParameters(), 30.f, kGoal, 12.f, 0.2f,
+                cost_matrix, image_data, false);
+  return cost_matrix;
+}
+}
+
+static void BM_processPointcloud(benchmark::State& state) {
+  const std::vector<pcl::PointCloud<pcl::PointXYZ>> complete_cloud = {makeCloud(state.range(0))};
+  const std::vector<FOV> fov = {FOV(0.f, 0.f, 85.f, 65.f)};
+  pcl::PointCloud<pcl::PointXYZI> final_cloud;
+  ObstacleMemory memory;
+  FOVMask fov_mask;
+  for (auto _ : state) {
+    processPointcloud(final_cloud, memory, fov_mask, complete_cloud, fov, 0.f, 0.f, kPosition, 0.2f, 12.f, 20.f, 0.1f,
+                      1);
+    benchmark::DoNotOptimize(final_cloud.points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_processPointcloud)->Arg(1000)->Arg(10000)->Arg(100000)->Arg(300000)->Unit(benchmark::kMicrosecond);
+
+// remembered cells outside the current FOV, only the new data and the FOV bins are visited unless the grid is rebuilt.
+// motion 0: the position is constant, 1: hover with millimeter jitter of the position estimate, 2: flight back and
+// forth at 1 m/s and 10 Hz, which rebuilds the grid every cycle
+static void BM_processPointcloudMemory(benchmark::State& state) {
+  const std::vector<pcl::PointCloud<pcl::PointXYZ>> seed_cloud = {makeCloud(state.range(0))};
+  const std::vector<pcl::PointCloud<pcl::PointXYZ>> complete_cloud = {makeCloud(1)};
+  const std::vector<FOV> fov = {FOV(180.f, 0.f, 85.f, 65.f)};
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<float> jitter(-0.0015f, 0.0015f);
+  pcl::PointCloud<pcl::PointXYZI> final_cloud;
+  ObstacleMemory memory;
+  FOVMask fov_mask;
+  processPointcloud(final_cloud, memory, fov_mask, seed_cloud, fov, 0.f, 0.f, kPosition, 0.2f, 12.f, 20.f, 0.f, 1);
+  int cycle = 0;
+  for (auto _ : state) {
+    Eigen::Vector3f position = kPosition;
+    if (state.range(1) == 1) {
+      position += Eigen::Vector3f(jitter(generator), jitter(generator), jitter(generator));
+    } else if (state.range(1) == 2) {
+      position.x() += 0.1f * std::abs(cycle++ % 20 - 10);
+    }
+    processPointcloud(final_cloud, memory, fov_mask, complete_cloud, fov, 0.f, 0.f, position, 0.2f, 12.f, 20.f, 0.f,
+                      1);
+    benchmark::DoNotOptimize(final_cloud.points.data());
+  }
+  state.SetItemsProcessed(state.iterations() * final_cloud.points.size());
+}
+BENCHMARK(BM_processPointcloudMemory)
+    ->ArgNames({"points", "motion"})
+    ->Args({10000, 0})
+    ->Args({10000, 1})
+    ->Args({10000, 2})
+    ->Args({100000, 0})
+    ->Args({100000, 1})
+    ->Args({100000, 2})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_generateNewHistogram(benchmark::State& state) {
+  const pcl::PointCloud<pcl::PointXYZI> cloud = makeCloudXYZI(state.range(0));
+  Histogram histogram(ALPHA_RES);
+  for (auto _ : state) {
+    generateNewHistogram(histogram, cloud, kPosition);
+    benchmark::ClobberMemory();
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_generateNewHistogram)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+static void BM_getCostMatrix(benchmark::State& state) {
+  const Histogram histogram = makeHistogram(10000);
+  const bool generate_image = state.range(0) != 0;
+  Eigen::MatrixXf cost_matrix;
+  std::vector<uint8_t> image_data;
+  for (auto _ : state) {
+    getCostMatrix(histogram, kGoal, kPosition, kVelocity, costParameters(), 30.f, kGoal, 12.f, 0.2f, cost_matrix,
+                  image_data, generate_image);
+    benchmark::DoNotOptimize(cost_matrix.data());
+  }
+}
+BENCHMARK(BM_getCostMatrix)->ArgName("image")->Arg(0)->Arg(1)->Unit(benchmark::kMicrosecond);
+
+static void BM_smoothPolarMatrix(benchmark::State& state) {
+  const Eigen::MatrixXf input = makeCostMatrix();
+  Eigen::MatrixXf matrix;
+  for (auto _ : state) {
+    matrix = input;
+    smoothPolarMatrix(matrix, state.range(0));
+    benchmark::DoNotOptimize(matrix.data());
+  }
+}
+BENCHMARK(BM_smoothPolarMatrix)->ArgName("radius")->Arg(1)->Arg(5)->Arg(10)->Unit(benchmark::kMicrosecond);
+
+static void BM_getBestCandidatesFromCostMatrix(benchmark::State& state) {
+  const Eigen::MatrixXf cost_matrix = makeCostMatrix();
+  std::vector<candidateDirection> candidates;
+  for (auto _ : state) {
+    getBestCandidatesFromCostMatrix(cost_matrix, state.range(0), candidates, static_cast<float>(state.range(1)));
+    benchmark::DoNotOptimize(candidates.data());
+  }
+}
+BENCHMARK(BM_getBestCandidatesFromCostMatrix)
+    ->ArgNames({"candidates", "min_angle"})
+    ->Args({1, 0})
+    ->Args({8, 0})
+    ->Args({50, 0})
+    ->Args({8, 20})
+    ->Unit(benchmark::kMicrosecond);
+
+static void BM_buildLookAheadTree(benchmark::State& state) {
+  StarPlanner star_planner;
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  config.n_expanded_nodes_ = state.range(0);
+  config.tree_node_distance_ = 3.0;
+  config.max_sensor_range_ = 40.0;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.setParams(costParameters());
+  star_planner.setPointcloud(makeCloudXYZI(10000));
+  star_planner.setPose(kPosition, kVelocity);
+  star_planner.setGoal(kGoal);
+  star_planner.setClosestPointOnLine(kGoal);
+  for (auto _ : state) {
+    star_planner.buildLookAheadTree();
+  }
+  state.counters["tree_nodes"] = star_planner.tree_.size();
+}
+BENCHMARK(BM_buildLookAheadTree)->ArgName("expanded")->Arg(50)->Arg(200)->Arg(1000)->Unit(benchmark::kMillisecond);
+
+static void BM_TransformBufferGetTransform(benchmark::State& state) {
+  // 10s of transforms at 200Hz, queried at the given age in percent of the buffer length
+  tf_buffer::TransformBuffer buffer(10.f);
+  const ros::Time start(1000.0);
+  const int num_transforms = 2000;
+  for (int i = 0; i < num_transforms; i++) {
+    tf::StampedTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(tf::Vector3(0.01 * i, 0.0, 1.0));
+    transform.stamp_ = start + ros::Duration(0.005 * i);
+    buffer.insertTransform("camera_link", "local_origin", transform);
+  }
+  const ros::Time query = start + ros::Duration(0.005 * (num_transforms - 1) * (1.0 - 0.01 * state.range(0)) - 0.0025);
+  const tf_buffer::FramePairHandle frame_pair = buffer.getFramePairHandle("camera_link", "local_origin");
+  const bool use_handle = state.range(1) != 0;
+  tf::StampedTransform transform;
+  for (auto _ : state) {
+    if (use_handle) {
+      benchmark::DoNotOptimize(buffer.getTransform(frame_pair, query, transform));
+    } else {
+      benchmark::DoNotOptimize(buffer.getTransform("camera_link", "local_origin", query, transform));
+    }
+  }
+}
+BENCHMARK(BM_TransformBufferGetTransform)
+    ->ArgNames({"age_percent", "handle"})
+    ->Args({0, 0})
+    ->Args({50, 0})
+    ->Args({99, 0})
+    ->Args({0, 1})
+    ->Args({50, 1})
+    ->Args({99, 1});
+
+template <typename Buffer>
+static void BM_TransformBufferConcurrentLookups(benchmark::State& state) {
+  // one buffer shared by all benchmark threads, like the camera threads of the nodelet share theirs
+  static Buffer buffer(10.f);
+  static const tf_buffer::FramePairHandle frame_pair = [&]() {
+    const tf_buffer::FramePairHandle handle = buffer.getFramePairHandle("camera_link", "local_origin");
+    for (int i = 0; i < 2000; i++) {
+      tf::StampedTransform transform;
+      transform.setIdentity();
+      transform.setOrigin(tf::Vector3(0.01 * i, 0.0, 1.0));
+      transform.stamp_ = ros::Time(1000.0) + ros::Duration(0.005 * i);
+      buffer.insertTransform(handle, transform);
+    }
+    return handle;
+  }();
+  const ros::Time query = ros::Time(1000.0) + ros::Duration(5.0025);
+  tf::StampedTransform transform;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(buffer.getTransform(frame_pair, query, transform));
+  }
+}
+BENCHMARK_TEMPLATE(BM_TransformBufferConcurrentLookups, tf_buffer::TransformBuffer)->ThreadRange(1, 8)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_TransformBufferConcurrentLookups, tf_buffer::ConcurrentTransformBuffer)
+    ->ThreadRange(1, 8)
+    ->UseRealTime();
+
+static void BM_removeNaNAndGetMaxima(benchmark::State& state) {
+  const pcl::PointCloud<pcl::PointXYZ> input = makeCloud(state.range(0), 0.3f);
+  pcl::PointCloud<pcl::PointXYZ> cloud;
+  for (auto _ : state) {
+    state.PauseTiming();
+    cloud = input;
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(removeNaNAndGetMaxima(cloud));
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_removeNaNAndGetMaxima)->Arg(10000)->Arg(300000)->Unit(benchmark::kMicrosecond);
+
+static void BM_transformPointCloud2AndGetMaxima(benchmark::State& state) {
+  // a 640x480 depth image, transformed with a single transform (0) or de-skewed with one transform per slice of rows
+  const uint32_t width = 640, height = 480;
+  const pcl::PointCloud<pcl::PointXYZ> points = makeCloud(width * height, 0.3f);
+  sensor_msgs::PointCloud2 msg;
+  msg.width = width;
+  msg.height = height;
+  msg.point_step = 3 * sizeof(float);
+  msg.row_step = width * msg.point_step;
+  const char* names[3] = {"x", "y", "z"};
+  for (uint32_t k = 0; k < 3; ++k) {
+    sensor_msgs::PointField field;
+    field.name = names[k];
+    field.offset = k * sizeof(float);
+    field.datatype = sensor_msgs::PointField::FLOAT32;
+    field.count = 1;
+    msg.fields.push_back(field);
+  }
+  msg.data.resize(msg.row_step * height);
+  for (size_t i = 0; i < points.size(); ++i) {
+    std::memcpy(&msg.data[i * msg.point_step], &points.points[i].x, sizeof(float));
+    std::memcpy(&msg.data[i * msg.point_step + sizeof(float)], &points.points[i].y, sizeof(float));
+    std::memcpy(&msg.data[i * msg.point_step + 2 * sizeof(float)], &points.points[i].z, sizeof(float));
+  }
+
+  const ros::Time stamp(1000.0);
+  auto lookup = [](const ros::Time& time, tf::StampedTransform& transform) {
+    transform.setIdentity();
+    transform.setOrigin(tf::Vector3(5.0 * (time.toSec() - 1000.0), 0.0, 1.0));
+    transform.stamp_ = time;
+    return true;
+  };
+  const size_t num_slices = state.range(0);
+  std::vector<tf::StampedTransform> slice_transforms;
+  Eigen::Affine3f transform = Eigen::Affine3f::Identity();
+  transform.translation() = Eigen::Vector3f(0.f, 0.f, 1.f);
+
+  pcl::PointCloud<pcl::PointXYZ> cloud, maxima;
+  for (auto _ : state) {
+    if (num_slices == 0) {
+      benchmark::DoNotOptimize(transformPointCloud2AndGetMaxima(msg, transform, 12.f, cloud, maxima));
+    } else {
+      getSliceTransforms(stamp, ros::Duration(0.03), num_slices, lookup, slice_transforms);
+      benchmark::DoNotOptimize(transformPointCloud2AndGetMaxima(msg, slice_transforms, 12.f, cloud, maxima));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * width * height);
+}
+BENCHMARK(BM_transformPointCloud2AndGetMaxima)
+    ->ArgName("slices")
+    ->Arg(0)
+    ->Arg(8)
+    ->Arg(480)
+    ->Unit(benchmark::kMicrosecond);
+
+int main(int argc, char** argv) {
+  ros::Time::init();
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+  benchmark::RunSpecifiedBenchmarks();
+  return 0;
+}
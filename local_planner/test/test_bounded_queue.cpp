@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#include "../include/local_planner/bounded_queue.h"
+
+using namespace avoidance;
+
+TEST(BoundedQueue, dropsOldestWhenFull) {
+  // GIVEN: a queue with room for two elements
+  BoundedQueue<int> queue(2);
+
+  // WHEN: three elements are pushed
+  EXPECT_FALSE(queue.push(1));
+  EXPECT_FALSE(queue.push(2));
+  EXPECT_TRUE(queue.push(3));
+
+  // THEN: the oldest one should have been dropped
+  EXPECT_EQ(2u, queue.size());
+  int item = 0;
+  EXPECT_TRUE(queue.pop(item));
+  EXPECT_EQ(2, item);
+  EXPECT_TRUE(queue.pop(item));
+  EXPECT_EQ(3, item);
+}
+
+TEST(BoundedQueue, closeWakesConsumer) {
+  // GIVEN: a consumer waiting on an empty queue
+  BoundedQueue<int> queue;
+  bool popped = true;
+  std::thread consumer([&]() {
+    int item;
+    popped = queue.pop(item);
+  });
+
+  // WHEN: the queue is closed
+  queue.close();
+  consumer.join();
+
+  // THEN: the consumer should return without an element and pushes should be ignored
+  EXPECT_FALSE(popped);
+  queue.push(1);
+  EXPECT_EQ(0u, queue.size());
+}
+
+TEST(BoundedQueue, handsOverInOrder) {
+  // GIVEN: a producer pushing increasing numbers into a single element queue
+  BoundedQueue<int> queue(1);
+  const int num_items = 10000;
+  std::thread producer([&]() {
+    for (int i = 1; i <= num_items; i++) queue.push(int(i));
+    queue.close();
+  });
+
+  // WHEN: the consumer pops until the queue is closed
+  int last = 0;
+  bool in_order = true;
+  int item;
+  while (queue.pop(item)) {
+    in_order &= item > last;
+    last = item;
+  }
+  producer.join();
+
+  // THEN: the elements should arrive in order and the last one should never be dropped
+  EXPECT_TRUE(in_order);
+  EXPECT_EQ(num_items, last);
+}
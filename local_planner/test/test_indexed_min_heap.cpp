@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../include/local_planner/indexed_min_heap.h"
+
+using namespace avoidance;
+
+TEST(IndexedMinHeap, popsInKeyOrder) {
+  // GIVEN: a heap filled with random keys, some of them equal
+  std::mt19937 generator(3);
+  std::uniform_int_distribution<int> key(0, 50);
+  std::vector<std::pair<float, int>> entries;
+  IndexedMinHeap heap;
+  for (int id = 0; id < 200; id++) {
+    entries.emplace_back(static_cast<float>(key(generator)), id);
+    heap.push(id, entries.back().first);
+  }
+
+  // WHEN: we change some keys and remove some ids
+  for (int id = 0; id < 200; id += 7) {
+    entries[id].first = static_cast<float>(key(generator));
+    heap.push(id, entries[id].first);
+  }
+  for (int id = 3; id < 200; id += 11) {
+    heap.erase(id);
+    entries[id].first = -1.f;
+  }
+  heap.erase(1000);  // not contained
+  EXPECT_FALSE(heap.contains(3));
+  EXPECT_TRUE(heap.contains(4));
+
+  // THEN: the ids should come out ordered by key, then by id
+  std::sort(entries.begin(), entries.end());
+  std::vector<int> expected, popped;
+  for (const auto& entry : entries) {
+    if (entry.first >= 0.f) expected.push_back(entry.second);
+  }
+  ASSERT_EQ(expected.size(), heap.size());
+  while (!heap.empty()) {
+    int top = heap.top();
+    popped.push_back(heap.pop());
+    EXPECT_EQ(top, popped.back());
+  }
+  EXPECT_EQ(expected, popped);
+
+  // THEN: a cleared heap should not contain anything
+  heap.push(5, 1.f);
+  heap.clear();
+  EXPECT_TRUE(heap.empty());
+  EXPECT_FALSE(heap.contains(5));
+}
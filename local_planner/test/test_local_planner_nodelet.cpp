@@ -194,3 +194,56 @@ TEST(LocalPlannerNodeletTests, mission_item_speed) {
     }
   }
 }
+
+TEST(LocalPlannerNodeletTests, staticTransformChain) {
+  ros::Time::init();
+  // GIVEN: a camera mounted on the vehicle, whose chain to the fcu frame is only published on /tf_static, and the
+  // vehicle pose published on /tf
+  auto edge = [](const std::string& parent, const std::string& child, const ros::Time& stamp, double x) {
+    geometry_msgs::TransformStamped transform;
+    transform.header.frame_id = parent;
+    transform.header.stamp = stamp;
+    transform.child_frame_id = child;
+    transform.transform.translation.x = x;
+    transform.transform.rotation.w = 1.0;
+    return transform;
+  };
+  const ros::Time pose_stamp(1000.0);
+  tf2::BufferCore tf_tree;
+  tf_tree.setTransform(edge("fcu", "camera_link", pose_stamp, 0.1), "test", true);
+  tf_tree.setTransform(edge("camera_link", "camera_depth_optical_frame", pose_stamp, 0.02), "test", true);
+  tf_tree.setTransform(edge("local_origin", "fcu", pose_stamp, 5.0), "test", false);
+
+  tf_buffer::ConcurrentTransformBuffer tf_buffer;
+  bufferedFramePair fcu_pair, local_origin_pair;
+  fcu_pair.handle = tf_buffer.getFramePairHandle("camera_depth_optical_frame", "fcu");
+  local_origin_pair.handle = tf_buffer.getFramePairHandle("camera_depth_optical_frame", "local_origin");
+
+  // WHEN: both chains are looked up at time zero, as on every tf message, and buffered
+  tf::StampedTransform transform;
+  tf::transformStampedMsgToTF(tf_tree.lookupTransform("fcu", "camera_depth_optical_frame", ros::Time(0)), transform);
+  EXPECT_TRUE(fcu_pair.insert(tf_buffer, transform));
+  tf::transformStampedMsgToTF(tf_tree.lookupTransform("local_origin", "camera_depth_optical_frame", ros::Time(0)),
+                              transform);
+  EXPECT_TRUE(local_origin_pair.insert(tf_buffer, transform));
+
+  // THEN: the static chain should wake the waiters of any cloud, the other one only up to the pose stamp
+  const ros::Time cloud_stamp = pose_stamp + ros::Duration(60.0);
+  EXPECT_TRUE(fcu_pair.is_static);
+  EXPECT_TRUE(fcu_pair.covers(cloud_stamp));
+  EXPECT_FALSE(local_origin_pair.is_static);
+  EXPECT_TRUE(local_origin_pair.covers(pose_stamp));
+  EXPECT_FALSE(local_origin_pair.covers(cloud_stamp));
+
+  // THEN: the static chain should be retrieved for any cloud stamp
+  tf::StampedTransform retrieved_transform;
+  ASSERT_TRUE(tf_buffer.getTransform(fcu_pair.handle, cloud_stamp, retrieved_transform));
+  EXPECT_EQ(cloud_stamp, retrieved_transform.stamp_);
+  EXPECT_NEAR(0.12, retrieved_transform.getOrigin().x(), 1e-6);
+  EXPECT_FALSE(tf_buffer.getTransform(local_origin_pair.handle, cloud_stamp, retrieved_transform));
+
+  // WHEN: the unchanged static chain is looked up again THEN: it is not inserted again and stays valid
+  tf::transformStampedMsgToTF(tf_tree.lookupTransform("fcu", "camera_depth_optical_frame", ros::Time(0)), transform);
+  EXPECT_FALSE(fcu_pair.insert(tf_buffer, transform));
+  EXPECT_TRUE(fcu_pair.covers(cloud_stamp));
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+
+#include "../include/local_planner/obstacle_memory.h"
+#include "avoidance/common.h"
+
+using namespace avoidance;
+
+namespace {
+int binOf(const ObstacleMemory& memory, const Eigen::Vector3f& point) {
+  Eigen::Vector2i index = polarToHistogramIndex(cartesianToPolarHistogram(point, memory.origin()), memory.res());
+  return index.y() * (360 / memory.res()) + index.x();
+}
+}
+
+TEST(ObstacleMemory, insertReplacesBin) {
+  // GIVEN: an empty memory
+  ObstacleMemory memory;
+  EXPECT_EQ(0, memory.size());
+
+  // WHEN: we insert two points in the same direction and one in another direction
+  memory.insert(Eigen::Vector3f(5.f, 0.5f, 1.f), 3.f);
+  memory.insert(Eigen::Vector3f(6.f, 0.6f, 1.2f));
+  memory.insert(Eigen::Vector3f(-5.f, 0.5f, 1.f));
+
+  // THEN: the second observation should replace the first one including its age
+  ASSERT_EQ(2, memory.size());
+  const pcl::PointXYZI* cell = memory.cell(binOf(memory, Eigen::Vector3f(5.f, 0.5f, 1.f)));
+  ASSERT_NE(nullptr, cell);
+  EXPECT_FLOAT_EQ(6.f, cell->x);
+  EXPECT_FLOAT_EQ(0.f, memory.age(*cell));
+
+  // THEN: a forgotten bin should be empty
+  memory.forget(binOf(memory, Eigen::Vector3f(-5.f, 0.5f, 1.f)));
+  ASSERT_EQ(1, memory.size());
+  EXPECT_EQ(nullptr, memory.cell(binOf(memory, Eigen::Vector3f(-5.f, 0.5f, 1.f))));
+  EXPECT_FLOAT_EQ(6.f, memory.cells().points[0].x);
+}
+
+TEST(ObstacleMemory, ageAndExpire) {
+  // GIVEN: a memory with three cells of different age
+  ObstacleMemory memory;
+  const Eigen::Vector3f p1(1.f, 0.f, 0.f), p2(0.f, 2.f, 0.f), p3(-3.f, 0.f, 0.f);
+  memory.insert(p1, 2.f);
+  memory.insert(p2, 6.f);
+  memory.insert(p3);
+
+  // WHEN: time passes and the cells of 5s or older are expired
+  memory.advance(1.5f);
+  memory.expire(5.f);
+
+  // THEN: the old cell should be removed and the others aged by the elapsed time
+  ASSERT_EQ(2, memory.size());
+  EXPECT_EQ(nullptr, memory.cell(binOf(memory, p2)));
+  ASSERT_NE(nullptr, memory.cell(binOf(memory, p1)));
+  EXPECT_FLOAT_EQ(3.5f, memory.age(*memory.cell(binOf(memory, p1))));
+  ASSERT_NE(nullptr, memory.cell(binOf(memory, p3)));
+  EXPECT_FLOAT_EQ(1.5f, memory.age(*memory.cell(binOf(memory, p3))));
+
+  // WHEN: a bin is observed again before its old observation expires
+  memory.insert(Eigen::Vector3f(1.02f, 0.f, 0.f));
+  memory.advance(2.f);
+  memory.expire(5.f);
+
+  // THEN: the new observation should be kept
+  ASSERT_EQ(2, memory.size());
+  ASSERT_NE(nullptr, memory.cell(binOf(memory, p1)));
+  EXPECT_FLOAT_EQ(1.02f, memory.cell(binOf(memory, p1))->x);
+  EXPECT_FLOAT_EQ(2.f, memory.age(*memory.cell(binOf(memory, p1))));
+
+  memory.clear();
+  EXPECT_EQ(0, memory.size());
+  EXPECT_EQ(nullptr, memory.cell(binOf(memory, p1)));
+}
+
+TEST(ObstacleMemory, moveToRebinsCells) {
+  // GIVEN: a memory with two cells in different directions and one far away
+  ObstacleMemory memory;
+  const Eigen::Vector3f p1(0.f, 1.05f, 0.f), p2(0.5f, 0.95f, 0.f), p3(30.f, 0.f, 0.f);
+  memory.insert(p1, 3.f);
+  memory.insert(p2, 1.f);
+  memory.insert(p3);
+  ASSERT_EQ(3, memory.size());
+  ASSERT_NE(binOf(memory, p1), binOf(memory, p2));
+
+  // WHEN: the vehicle moves less than the tolerance THEN: the grid should be kept
+  EXPECT_FALSE(memory.moveTo(Eigen::Vector3f(0.003f, -0.002f, 0.001f), 20.f, 0.005f));
+  EXPECT_EQ(Eigen::Vector3f::Zero(), memory.origin());
+  EXPECT_EQ(3, memory.size());
+
+  // WHEN: the vehicle moves such that the first two cells share a bin and the third one is out of range
+  EXPECT_TRUE(memory.moveTo(Eigen::Vector3f(-10.f, 0.f, 0.f), 20.f, 0.005f));
+
+  // THEN: only the newer of the two cells should be kept
+  ASSERT_EQ(binOf(memory, p1), binOf(memory, p2));
+  ASSERT_EQ(1, memory.size());
+  ASSERT_NE(nullptr, memory.cell(binOf(memory, p2)));
+  EXPECT_FLOAT_EQ(0.5f, memory.cell(binOf(memory, p2))->x);
+
+  // THEN: the kept cell should still expire at its own age
+  memory.advance(2.f);
+  memory.expire(4.f);
+  EXPECT_EQ(1, memory.size());
+  memory.expire(2.5f);
+  EXPECT_EQ(0, memory.size());
+}
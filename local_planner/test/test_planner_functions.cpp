@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 #include <cmath>
+#include <type_traits>
 
 #include "../include/local_planner/planner_functions.h"
 
@@ -97,11 +98,13 @@ TEST(PlannerFunctionsTests, processPointcloud) {
   float max_sensor_dist = 12.f;
 
   pcl::PointCloud<pcl::PointXYZI> processed_cloud1, processed_cloud2, processed_cloud3;
+  ObstacleMemory memory1, memory2, memory3;
+  FOVMask fov_mask1, fov_mask2, fov_mask3;
   Eigen::Vector3f memory_point(1.4f, 0.0f, 0.0f);
   PolarPoint memory_point_polar = cartesianToPolarFCU(position + memory_point, position);
-  processed_cloud1.push_back(toXYZI(position + memory_point, 5.0f));
-  processed_cloud2.push_back(toXYZI(position + memory_point, 5.0f));
-  processed_cloud3.push_back(toXYZI(position + memory_point, 5.0f));
+  memory1.insert(position + memory_point, 5.0f);
+  memory2.insert(position + memory_point, 5.0f);
+  memory3.insert(position + memory_point, 5.0f);
 
   std::vector<FOV> FOV_zero;  // zero FOV means all pts are outside FOV, and thus remembered
   FOV_zero.push_back(FOV(1.0f, 1.0f, 0.0f, 0.0f));
@@ -110,15 +113,15 @@ TEST(PlannerFunctionsTests, processPointcloud) {
   FOV_regular.push_back(FOV(0.0f, 1.0f, 85.f, 65.f));
 
   // WHEN: we filter the PointCloud with different values max_age
-  processPointcloud(processed_cloud1, complete_cloud, FOV_zero, 0.0f, 0.0f, position, min_sensor_dist, max_sensor_dist,
-                    0.0f, 0.5f, 1);
+  processPointcloud(processed_cloud1, memory1, fov_mask1, complete_cloud, FOV_zero, 0.0f, 0.0f, position,
+                    min_sensor_dist, max_sensor_dist, 0.0f, 0.5f, 1);
 
   // todo: test different yaw and pitch
-  processPointcloud(processed_cloud2, complete_cloud, FOV_zero, 0.0f, 0.0f, position, min_sensor_dist, max_sensor_dist,
-                    10.0f, .5f, 1);
+  processPointcloud(processed_cloud2, memory2, fov_mask2, complete_cloud, FOV_zero, 0.0f, 0.0f, position,
+                    min_sensor_dist, max_sensor_dist, 10.0f, .5f, 1);
 
-  processPointcloud(processed_cloud3, complete_cloud, FOV_regular, 0.0f, 0.0f, position, min_sensor_dist,
-                    max_sensor_dist, 10.0f, 0.5f, 1);
+  processPointcloud(processed_cloud3, memory3, fov_mask3, complete_cloud, FOV_regular, 0.0f, 0.0f, position,
+                    min_sensor_dist, max_sensor_dist, 10.0f, 0.5f, 1);
 
   // THEN: we expect the first cloud to have 5 points
   // the second cloud should contain all 6 points
@@ -126,6 +129,64 @@ TEST(PlannerFunctionsTests, processPointcloud) {
   EXPECT_EQ(8, processed_cloud2.size());
   EXPECT_TRUE(pointInsideFOV(FOV_regular, memory_point_polar));
   EXPECT_EQ(7, processed_cloud3.size());  // since memory point is inside FOV, it isn't remembered
+
+  // the new data is remembered, as is the old point in the second case
+  EXPECT_EQ(7, memory1.size());
+  EXPECT_EQ(8, memory2.size());
+  EXPECT_EQ(7, memory3.size());
+}
+
+TEST(PlannerFunctionsTests, processPointcloudHeader) {
+  // GIVEN: a camera without a new frame, whose cloud has no header, and two cameras with new frames
+  const Eigen::Vector3f position(0.f, 0.f, 4.f);
+  std::vector<pcl::PointCloud<pcl::PointXYZ>> complete_cloud(3);
+  complete_cloud[1].push_back(toXYZ(position + Eigen::Vector3f(2.f, 0.f, 0.f)));
+  complete_cloud[1].header.stamp = 1000;
+  complete_cloud[1].header.frame_id = "/local_origin";
+  complete_cloud[2].push_back(toXYZ(position + Eigen::Vector3f(-2.f, 0.f, 0.f)));
+  complete_cloud[2].header.stamp = 2000;
+  complete_cloud[2].header.frame_id = "/local_origin";
+  std::vector<FOV> fov(3);
+
+  // WHEN: we fuse the clouds
+  pcl::PointCloud<pcl::PointXYZI> processed_cloud;
+  ObstacleMemory memory;
+  FOVMask fov_mask;
+  processPointcloud(processed_cloud, memory, fov_mask, complete_cloud, fov, 0.f, 0.f, position, 0.2f, 12.f, 10.f, 0.1f,
+                    1);
+
+  // THEN: the fused cloud should carry the header of the newest frame
+  EXPECT_EQ(2, processed_cloud.size());
+  EXPECT_EQ(2000, processed_cloud.header.stamp);
+  EXPECT_EQ("/local_origin", processed_cloud.header.frame_id);
+}
+
+TEST(PlannerFunctionsTests, processPointcloudPositionJitter) {
+  // GIVEN: a memory with a cell in front of and one behind the vehicle
+  const Eigen::Vector3f position(0.f, 0.f, 4.f);
+  const Eigen::Vector3f front(3.f, 0.f, 0.f), back(-3.f, 0.f, 0.f);
+  std::vector<pcl::PointCloud<pcl::PointXYZ>> complete_cloud(1);
+  complete_cloud[0].push_back(toXYZ(position + front));
+  complete_cloud[0].push_back(toXYZ(position + back));
+  std::vector<FOV> no_fov(1, FOV(0.f, 0.f, 0.f, 0.f));
+  pcl::PointCloud<pcl::PointXYZI> processed_cloud;
+  ObstacleMemory memory;
+  FOVMask fov_mask;
+  processPointcloud(processed_cloud, memory, fov_mask, complete_cloud, no_fov, 0.f, 0.f, position, 0.2f, 12.f, 10.f,
+                    0.1f, 1);
+  ASSERT_EQ(2, memory.size());
+
+  // WHEN: the position estimate jitters by millimeters while a forward facing camera sees nothing
+  const std::vector<FOV> fov(1, FOV(0.f, 0.f, 85.f, 65.f));
+  complete_cloud[0].clear();
+  const Eigen::Vector3f jittered = position + Eigen::Vector3f(0.001f, -0.001f, 0.0005f);
+  processPointcloud(processed_cloud, memory, fov_mask, complete_cloud, fov, 0.f, 0.f, jittered, 0.2f, 12.f, 10.f,
+                    0.1f, 1);
+
+  // THEN: the grid should stay where it was and only the cell in front of the vehicle should be forgotten
+  EXPECT_EQ(position, memory.origin());
+  ASSERT_EQ(1, processed_cloud.size());
+  EXPECT_FLOAT_EQ(back.x(), processed_cloud.points[0].x - position.x());
 }
 
 TEST(PlannerFunctions, compressHistogramElevation) {
@@ -340,6 +401,41 @@ TEST(PlannerFunctions, getBestCandidatesFromCostMatrix) {
   EXPECT_FLOAT_EQ(4.7, candidate_vector[3].cost);
 }
 
+TEST(PlannerFunctions, getBestCandidatesFromCostMatrixSuppression) {
+  // GIVEN: a cost matrix with a cheap cluster of adjacent cells and a more expensive separate cell
+  int n_candidates = 3;
+  std::vector<candidateDirection> candidate_vector;
+  Eigen::MatrixXf matrix;
+  matrix.resize(GRID_LENGTH_E, GRID_LENGTH_Z);
+  matrix.fill(10);
+  matrix(15, 30) = 1.f;
+  matrix(15, 31) = 1.5f;
+  matrix(16, 30) = 2.f;
+  matrix(15, 40) = 5.f;
+  matrix(15, 50) = 6.f;
+  matrix(0, 0) = NAN;
+
+  // WHEN: we select the candidates without suppression
+  getBestCandidatesFromCostMatrix(matrix, n_candidates, candidate_vector);
+
+  // THEN: the adjacent cells should be selected
+  ASSERT_EQ(n_candidates, candidate_vector.size());
+  EXPECT_FLOAT_EQ(1.f, candidate_vector[0].cost);
+  EXPECT_FLOAT_EQ(1.5f, candidate_vector[1].cost);
+  EXPECT_FLOAT_EQ(2.f, candidate_vector[2].cost);
+
+  // WHEN: we suppress directions closer than 20 degrees to a cheaper candidate
+  getBestCandidatesFromCostMatrix(matrix, n_candidates, candidate_vector, 20.f);
+
+  // THEN: only the cheapest cell of the cluster should be kept
+  ASSERT_EQ(n_candidates, candidate_vector.size());
+  EXPECT_FLOAT_EQ(1.f, candidate_vector[0].cost);
+  EXPECT_FLOAT_EQ(5.f, candidate_vector[1].cost);
+  EXPECT_FLOAT_EQ(6.f, candidate_vector[2].cost);
+  EXPECT_FLOAT_EQ(histogramIndexToPolar(15, 40, ALPHA_RES, 1.f).e, candidate_vector[1].elevation_angle);
+  EXPECT_FLOAT_EQ(histogramIndexToPolar(15, 40, ALPHA_RES, 1.f).z, candidate_vector[1].azimuth_angle);
+}
+
 TEST(PlannerFunctions, smoothPolarMatrix) {
   // GIVEN: a smoothing radius and a known cost matrix with one costly cell,
   // otherwise all zeros.
@@ -404,6 +500,101 @@ TEST(PlannerFunctions, smoothMatrix) {
   EXPECT_LT((expected_matrix - matrix).cwiseAbs().maxCoeff(), 1e-5);
 }
 
+TEST(PlannerFunctions, smoothPolarMatrixMatchesConicKernel) {
+  for (unsigned int smooth_radius = 0; smooth_radius <= 7; smooth_radius++) {
+    // GIVEN: a random cost matrix
+    std::srand(smooth_radius);
+    Eigen::MatrixXf matrix = Eigen::MatrixXf::Random(GRID_LENGTH_E, GRID_LENGTH_Z) * 1000.f;
+
+    // WHEN: we smooth it and convolve the padded matrix with the conic kernel directly
+    Eigen::MatrixXf matrix_padded;
+    padPolarMatrix(matrix, smooth_radius, matrix_padded);
+    Eigen::ArrayXf kernel = getConicKernel(smooth_radius);
+    int kernel_size = 2 * smooth_radius + 1;
+    for (int c = 0; c < matrix_padded.cols(); c++) {
+      Eigen::ArrayXf col = matrix_padded.col(c);
+      for (int r = 0; r < matrix.rows(); r++) {
+        matrix_padded(r + smooth_radius, c) = (col.segment(r, kernel_size) * kernel).sum();
+      }
+    }
+    Eigen::MatrixXf expected_matrix(matrix.rows(), matrix.cols());
+    for (int r = 0; r < matrix.rows(); r++) {
+      Eigen::ArrayXf row = matrix_padded.row(r + smooth_radius);
+      for (int c = 0; c < matrix.cols(); c++) {
+        expected_matrix(r, c) = (row.segment(c, kernel_size) * kernel).sum();
+      }
+    }
+    smoothPolarMatrix(matrix, smooth_radius);
+
+    // THEN: both should match within float precision
+    EXPECT_LT((expected_matrix - matrix).cwiseAbs().maxCoeff(), 1e-5f * expected_matrix.cwiseAbs().maxCoeff())
+        << "radius " << smooth_radius;
+  }
+}
+
+TEST(PlannerFunctions, evaluateCostMatrixMatchesCostFunction) {
+  // GIVEN: a histogram with obstacles in some bins and a goal close enough to scale the pitch cost
+  Eigen::Vector3f position(1.f, -2.f, 3.f);
+  Eigen::Vector3f velocity(0.5f, 1.f, -0.3f);
+  Eigen::Vector3f goal(3.f, 1.f, 4.f);
+  Eigen::Vector3f closest_pt(-1.f, 2.f, 4.f);
+  costParameters cost_params;
+  cost_params.yaw_cost_param = 2.5f;
+  cost_params.pitch_cost_param = 10.0f;
+  cost_params.velocity_cost_param = 1200.f;
+  cost_params.obstacle_cost_param = 5.0f;
+  Histogram histogram = Histogram(ALPHA_RES);
+  for (int e = 0; e < GRID_LENGTH_E; e++) {
+    for (int z = (e % 3); z < GRID_LENGTH_Z; z += 4) {
+      histogram.set_dist(e, z, 0.5f + 0.1f * (e + z));
+    }
+  }
+
+  for (bool is_obstacle_facing_goal : {false, true}) {
+    // WHEN: we evaluate the whole matrix
+    Eigen::MatrixXf distance_matrix, cost_matrix;
+    evaluateCostMatrix(histogram, goal, position, velocity, cost_params, closest_pt, is_obstacle_facing_goal,
+                       distance_matrix, cost_matrix);
+
+    // THEN: every bin should match the cost function
+    ASSERT_EQ(GRID_LENGTH_E, cost_matrix.rows());
+    ASSERT_EQ(GRID_LENGTH_Z, cost_matrix.cols());
+    for (int e = 0; e < GRID_LENGTH_E; e++) {
+      for (int z = 0; z < GRID_LENGTH_Z; z++) {
+        PolarPoint p_pol = histogramIndexToPolar(e, z, ALPHA_RES, 1.0f);
+        std::pair<float, float> costs = costFunction(p_pol, histogram.get_dist(e, z), goal, position, velocity,
+                                                     cost_params, closest_pt, is_obstacle_facing_goal);
+        EXPECT_NEAR(costs.first, distance_matrix(e, z), 1e-5f * std::abs(costs.first) + 1e-3f);
+        EXPECT_NEAR(costs.second, cost_matrix(e, z), 1e-5f * std::abs(costs.second) + 1e-2f);
+      }
+    }
+  }
+}
+
+TEST(PlannerFunctions, getCostMatrixWithoutImage) {
+  // GIVEN: a histogram with an obstacle in front of the vehicle
+  Eigen::Vector3f position(0.f, 0.f, 0.f);
+  Eigen::Vector3f velocity(1.f, 0.f, 0.f);
+  Eigen::Vector3f goal(0.f, 5.f, 0.f);
+  costParameters cost_params;
+  Histogram histogram = Histogram(ALPHA_RES);
+  Eigen::Vector2i obstacle_index = polarToHistogramIndex(cartesianToPolarHistogram(goal, position), ALPHA_RES);
+  histogram.set_dist(obstacle_index.y(), obstacle_index.x(), 3.f);
+
+  // WHEN: we calculate the cost matrix with and without image
+  Eigen::MatrixXf cost_matrix, cost_matrix_no_image;
+  std::vector<uint8_t> cost_image_data, no_image_data(10, 1);
+  getCostMatrix(histogram, goal, position, velocity, cost_params, 30.f, goal, 15.f, 0.2f, cost_matrix,
+                cost_image_data);
+  getCostMatrix(histogram, goal, position, velocity, cost_params, 30.f, goal, 15.f, 0.2f, cost_matrix_no_image,
+                no_image_data, false);
+
+  // THEN: only the image should be missing
+  EXPECT_EQ(3 * GRID_LENGTH_E * GRID_LENGTH_Z, cost_image_data.size());
+  EXPECT_TRUE(no_image_data.empty());
+  EXPECT_TRUE(cost_matrix.isApprox(cost_matrix_no_image));
+}
+
 TEST(PlannerFunctions, getCostMatrixNoObstacles) {
   // GIVEN: a position, goal and an empty histogram
   Eigen::Vector3f position(0.f, 0.f, 0.f);
@@ -575,18 +766,18 @@ TEST(Histogram, HistogramDownsampleCorrectUsage) {
   histogram.set_dist(1, 1, 1.3);
 
   // WHEN: we downsample the histogram to have a larger bin size
-  histogram.downsample();
+  PolarHistogram<ALPHA_RES * 2> downsampled = histogram.downsample();
 
   // THEN: The downsampled histogram should fuse four cells of the regular
   // resolution histogram into one
   for (int i = 0; i < GRID_LENGTH_E / 2; ++i) {
     for (int j = 0; j < GRID_LENGTH_Z / 2; ++j) {
       if (i == 0 && j == 0) {
-        EXPECT_FLOAT_EQ(1.3, histogram.get_dist(i, j));
+        EXPECT_FLOAT_EQ(1.3, downsampled.get_dist(i, j));
       } else if (i == 1 && j == 1) {
-        EXPECT_FLOAT_EQ(0.0, histogram.get_dist(i, j));
+        EXPECT_FLOAT_EQ(0.0, downsampled.get_dist(i, j));
       } else {
-        EXPECT_FLOAT_EQ(0.0, histogram.get_dist(i, j));
+        EXPECT_FLOAT_EQ(0.0, downsampled.get_dist(i, j));
       }
     }
   }
@@ -594,11 +785,11 @@ TEST(Histogram, HistogramDownsampleCorrectUsage) {
 
 TEST(Histogram, HistogramUpsampleCorrectUsage) {
   // GIVEN: a histogram of the correct resolution
-  Histogram histogram = Histogram(ALPHA_RES * 2);
-  histogram.set_dist(0, 0, 1.3);
+  PolarHistogram<ALPHA_RES * 2> low_res_histogram;
+  low_res_histogram.set_dist(0, 0, 1.3);
 
   // WHEN: we upsample the histogram to have regular bin size
-  histogram.upsample();
+  Histogram histogram = low_res_histogram.upsample();
 
   // THEN: The upsampled histogram should split every cell of the lower
   // resolution histogram into four cells
@@ -616,14 +807,29 @@ TEST(Histogram, HistogramUpsampleCorrectUsage) {
 }
 
 TEST(Histogram, HistogramUpDownpsampleInorrectUsage) {
-  // GIVEN: a histogram of the correct resolution
-  Histogram low_res_histogram = Histogram(ALPHA_RES * 2);
-  Histogram high_res_histogram = Histogram(ALPHA_RES);
+  // GIVEN: histograms whose resolution is fixed at compile time
+  // THEN: resampling changes the histogram type and constructing a histogram
+  // with a mismatching resolution throws
+  static_assert(std::is_same<decltype(Histogram().downsample()), PolarHistogram<ALPHA_RES * 2>>::value,
+                "downsample() must double the bin size");
+  static_assert(std::is_same<decltype(PolarHistogram<ALPHA_RES * 2>().upsample()), Histogram>::value,
+                "upsample() must halve the bin size");
+  EXPECT_THROW(Histogram(ALPHA_RES * 2), std::logic_error);
+  EXPECT_NO_THROW(PolarHistogram<ALPHA_RES * 2>(ALPHA_RES * 2));
+}
 
-  // THEN: We expect the functions to throw if the input histogram has the wrong
-  // resolution
-  EXPECT_THROW(low_res_histogram.downsample(), std::logic_error);
-  EXPECT_THROW(high_res_histogram.upsample(), std::logic_error);
+TEST(Histogram, HistogramWrapIndex) {
+  // GIVEN: a histogram with one cell set in each corner
+  Histogram histogram = Histogram(ALPHA_RES);
+  histogram.set_dist(0, 0, 1.f);
+  histogram.set_dist(GRID_LENGTH_E - 1, GRID_LENGTH_Z - 1, 2.f);
+
+  // THEN: out of range indices should wrap around in both directions
+  EXPECT_FLOAT_EQ(1.f, histogram.get_dist(GRID_LENGTH_E, GRID_LENGTH_Z));
+  EXPECT_FLOAT_EQ(1.f, histogram.get_dist(-GRID_LENGTH_E, -2 * GRID_LENGTH_Z));
+  EXPECT_FLOAT_EQ(2.f, histogram.get_dist(-1, -1));
+  EXPECT_FLOAT_EQ(2.f, histogram.get_dist(2 * GRID_LENGTH_E - 1, GRID_LENGTH_Z - 1));
+  EXPECT_FLOAT_EQ(0.f, histogram.get_dist(1, -GRID_LENGTH_Z + 1));
 }
 
 TEST(Histogram, HistogramisEmpty) {
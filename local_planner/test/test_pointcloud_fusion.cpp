@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "../include/local_planner/pointcloud_fusion.h"
+
+using namespace avoidance;
+
+class PointcloudFusionTests : public ::testing::Test {
+ public:
+  PointcloudFusion fusion;
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  const Eigen::Vector3f position = Eigen::Vector3f(1.5f, 1.0f, 4.5f);
+  std::vector<FOV> fov_front = {FOV(0.0f, 0.0f, 85.f, 65.f)};
+  std::vector<FOV> fov_zero = {FOV(0.0f, 0.0f, 0.0f, 0.0f)};
+
+  void SetUp() override {
+    ros::Time::init();
+    config.min_num_points_per_cell_ = 1;
+    fusion.dynamicReconfigureSetParams(config);
+  }
+};
+
+TEST_F(PointcloudFusionTests, remembersObstaclesOutsideFOV) {
+  // GIVEN: a camera seeing one obstacle in front of the vehicle
+  std::vector<pcl::PointCloud<pcl::PointXYZ>> clouds(1);
+  clouds[0].push_back(toXYZ(position + Eigen::Vector3f(0.f, 3.f, 0.f)));
+  pcl::PointCloud<pcl::PointXYZI> fused_cloud;
+  fusion.fuse(fused_cloud, clouds, fov_front, position, 0.f, 0.f);
+  EXPECT_EQ(1u, fused_cloud.size());
+
+  // WHEN: the next frame does not see the obstacle anymore since it is outside the FOV
+  clouds[0].clear();
+  fusion.fuse(fused_cloud, clouds, fov_zero, position, 0.f, 0.f);
+
+  // THEN: the obstacle should still be part of the fused cloud
+  EXPECT_EQ(1u, fused_cloud.size());
+}
+
+TEST_F(PointcloudFusionTests, appliesSensorRange) {
+  // GIVEN: a sensor range reduced by reconfiguration
+  config.max_sensor_range_ = 5.0;
+  fusion.dynamicReconfigureSetParams(config);
+
+  // WHEN: a frame with one close and one far obstacle is fused
+  std::vector<pcl::PointCloud<pcl::PointXYZ>> clouds(1);
+  clouds[0].push_back(toXYZ(position + Eigen::Vector3f(0.f, 3.f, 0.f)));
+  clouds[0].push_back(toXYZ(position + Eigen::Vector3f(0.f, 8.f, 0.f)));
+  pcl::PointCloud<pcl::PointXYZI> fused_cloud;
+  fusion.fuse(fused_cloud, clouds, fov_front, position, 0.f, 0.f);
+
+  // THEN: only the close obstacle should be kept
+  ASSERT_EQ(1u, fused_cloud.size());
+  EXPECT_NEAR(position.y() + 3.f, fused_cloud.points[0].y, 0.1f);
+}
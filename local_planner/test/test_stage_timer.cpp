@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include "../include/local_planner/stage_timer.h"
+
+using namespace avoidance;
+
+TEST(StageTimer, ignoresSamplesWhileDisabled) {
+  // GIVEN: a timer which was never enabled
+  StageTimer timer;
+
+  // WHEN: we add samples and measure a scope
+  timer.addSample(PlannerStage::tree, 5.f);
+  { auto timing = timer.measure(PlannerStage::histogram); }
+
+  // THEN: no samples should have been collected
+  EXPECT_FALSE(timer.isEnabled());
+  EXPECT_EQ(0u, timer.getStatistics(PlannerStage::tree).samples);
+  EXPECT_EQ(0u, timer.getStatistics(PlannerStage::histogram).samples);
+}
+
+TEST(StageTimer, rollingStatistics) {
+  // GIVEN: an enabled timer
+  StageTimer timer;
+  timer.setEnabled(true);
+
+  // WHEN: we add more samples than fit into the window
+  for (size_t i = 0; i < StageTimer::DEFAULT_WINDOW_SIZE + 100; i++) {
+    timer.addSample(PlannerStage::cost_matrix, static_cast<float>(i));
+  }
+
+  // THEN: the statistics should only cover the latest samples
+  StageStatistics stats = timer.getStatistics(PlannerStage::cost_matrix);
+  const float first = 100.f;
+  const float last = static_cast<float>(StageTimer::DEFAULT_WINDOW_SIZE + 99);
+  EXPECT_EQ(StageTimer::DEFAULT_WINDOW_SIZE, stats.samples);
+  EXPECT_FLOAT_EQ(first, stats.min_ms);
+  EXPECT_FLOAT_EQ(0.5f * (first + last), stats.mean_ms);
+  EXPECT_FLOAT_EQ(last - 1.f, stats.p99_ms);
+
+  // AND: the other stages should be untouched
+  EXPECT_EQ(0u, timer.getStatistics(PlannerStage::tree).samples);
+}
+
+TEST(StageTimer, windowSize) {
+  // GIVEN: an enabled timer holding a sample
+  StageTimer timer(4);
+  timer.setEnabled(true);
+  timer.addSample(PlannerStage::transform, 1.f);
+
+  // WHEN: the window is resized and more samples than fit are added
+  timer.setWindowSize(2);
+  EXPECT_EQ(0u, timer.getStatistics(PlannerStage::transform).samples);
+  timer.addSample(PlannerStage::transform, 3.f);
+  timer.addSample(PlannerStage::transform, 5.f);
+  timer.addSample(PlannerStage::transform, 7.f);
+
+  // THEN: only the two latest samples should be used
+  StageStatistics stats = timer.getStatistics(PlannerStage::transform);
+  EXPECT_EQ(2u, stats.samples);
+  EXPECT_FLOAT_EQ(5.f, stats.min_ms);
+  EXPECT_FLOAT_EQ(6.f, stats.mean_ms);
+  EXPECT_FLOAT_EQ(7.f, stats.p99_ms);
+}
+
+TEST(StageTimer, reenablingDiscardsSamples) {
+  // GIVEN: a timer with a sample
+  StageTimer timer;
+  timer.setEnabled(true);
+  { auto timing = timer.measure(PlannerStage::tree); }
+  StageStatistics stats = timer.getStatistics(PlannerStage::tree);
+  EXPECT_EQ(1u, stats.samples);
+  EXPECT_GE(stats.min_ms, 0.f);
+
+  // WHEN: it is enabled again while running, and after being disabled
+  timer.setEnabled(true);
+  EXPECT_EQ(1u, timer.getStatistics(PlannerStage::tree).samples);
+  timer.setEnabled(false);
+  timer.setEnabled(true);
+
+  // THEN: only the restart should have discarded the sample
+  EXPECT_EQ(0u, timer.getStatistics(PlannerStage::tree).samples);
+}
+
+TEST(StageTimer, stageNames) {
+  EXPECT_EQ(std::string("cloud_receive"), stageName(PlannerStage::cloud_receive));
+  EXPECT_EQ(std::string("publish"), stageName(PlannerStage::publish));
+}
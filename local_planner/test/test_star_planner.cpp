@@ -92,4 +92,164 @@ TEST_F(StarPlannerTests, buildTree) {
   }
 }
 
+TEST_F(StarPlannerTests, parallelExpansionIsDeterministic) {
+  // GIVEN: the same planning problem expanded serially and on several threads
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  config.children_per_node_ = 2;
+  config.n_expanded_nodes_ = 10;
+  config.tree_node_distance_ = 1.0;
+  config.expansion_batch_size_ = 1;
+  config.expansion_threads_ = 1;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+  std::vector<Eigen::Vector3f> serial_path = star_planner.path_node_positions_;
+  size_t serial_tree_size = star_planner.tree_.size();
+
+  // WHEN: one node at a time is expanded on a thread pool
+  config.expansion_threads_ = 3;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+
+  // THEN: the tree should be the same as the serial one
+  EXPECT_EQ(serial_tree_size, star_planner.tree_.size());
+  ASSERT_EQ(serial_path.size(), star_planner.path_node_positions_.size());
+  for (size_t i = 0; i < serial_path.size(); i++) {
+    EXPECT_TRUE(serial_path[i].isApprox(star_planner.path_node_positions_[i]));
+  }
+
+  // WHEN: four nodes are expanded per batch, with one and with three threads
+  config.expansion_batch_size_ = 4;
+  config.expansion_threads_ = 1;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+  std::vector<Eigen::Vector3f> batch_path = star_planner.path_node_positions_;
+  size_t batch_closed_set_size = star_planner.closed_set_.size();
+
+  config.expansion_threads_ = 3;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+
+  // THEN: the expansion budget should be respected and the result should not depend on the thread count
+  EXPECT_LE(batch_closed_set_size, 10);
+  EXPECT_EQ(batch_closed_set_size, star_planner.closed_set_.size());
+  ASSERT_EQ(batch_path.size(), star_planner.path_node_positions_.size());
+  for (size_t i = 0; i < batch_path.size(); i++) {
+    EXPECT_TRUE(batch_path[i].isApprox(star_planner.path_node_positions_[i]));
+  }
+}
+
+TEST_F(StarPlannerTests, reuseTree) {
+  // GIVEN: a tree built with tree reuse enabled
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  config.children_per_node_ = 2;
+  config.n_expanded_nodes_ = 10;
+  config.tree_node_distance_ = 1.0;
+  config.reuse_tree_ = true;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+  std::vector<TreeNode> previous_tree = star_planner.tree_;
+  ASSERT_GE(star_planner.path_node_positions_.size(), 2);
+  Eigen::Vector3f next_position = star_planner.path_node_positions_[star_planner.path_node_positions_.size() - 2];
+
+  auto reusedNodes = [&]() {
+    int reused = 0;
+    for (size_t i = 1; i < star_planner.tree_.size(); i++) {
+      for (size_t j = 1; j < previous_tree.size(); j++) {
+        if ((star_planner.tree_[i].getPosition() - previous_tree[j].getPosition()).norm() < 1e-5f) {
+          reused++;
+          break;
+        }
+      }
+    }
+    return reused;
+  };
+
+  // WHEN: the vehicle moves along the path and the tree is built again
+  star_planner.setPose(next_position, velocity);
+  star_planner.buildLookAheadTree();
+
+  // THEN: the tree should be rooted at the vehicle, keep the branches ahead
+  // of it and still respect the expansion budget
+  EXPECT_TRUE(star_planner.tree_[0].getPosition().isApprox(next_position));
+  EXPECT_GT(reusedNodes(), 0);
+  EXPECT_LE(star_planner.closed_set_.size(), 10);
+  for (size_t i = 1; i < star_planner.tree_.size(); i++) {
+    EXPECT_LT(star_planner.tree_[i].origin_, i);
+    EXPECT_EQ(star_planner.tree_[i].depth_, star_planner.tree_[star_planner.tree_[i].origin_].depth_ + 1);
+  }
+
+  // WHEN: obstacles appear on all nodes of the previous tree
+  previous_tree = star_planner.tree_;
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  for (size_t i = 1; i < previous_tree.size(); i++) {
+    Eigen::Vector3f p = previous_tree[i].getPosition();
+    cloud.push_back(toXYZI(p.x(), p.y(), p.z(), 0));
+  }
+  star_planner.setPointcloud(cloud);
+  star_planner.buildLookAheadTree();
+
+  // THEN: all branches should be invalidated
+  EXPECT_EQ(0, reusedNodes());
+}
+
+TEST_F(StarPlannerTests, timeBudget) {
+  // GIVEN: a large expansion budget
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  config.children_per_node_ = 8;
+  config.n_expanded_nodes_ = 200;
+  config.tree_node_distance_ = 1.0;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+
+  // WHEN: we build the tree without time budget
+  star_planner.buildLookAheadTree();
+
+  // THEN: no slack should be reported
+  EXPECT_FALSE(std::isfinite(star_planner.getTimeSlack()));
+  int unlimited_expanded_nodes = star_planner.getExpandedNodes();
+  EXPECT_EQ(unlimited_expanded_nodes, star_planner.closed_set_.size());
+
+  // WHEN: we build the tree with a time budget too small for all expansions
+  config.tree_time_budget_ms_ = 0.01;
+  star_planner.dynamicReconfigureSetStarParams(config, 1);
+  star_planner.buildLookAheadTree();
+
+  // THEN: expansion should stop early, but still return a path
+  EXPECT_GE(star_planner.getExpandedNodes(), 1);
+  EXPECT_LT(star_planner.getExpandedNodes(), unlimited_expanded_nodes);
+  EXPECT_GE(star_planner.path_node_positions_.size(), 2);
+  EXPECT_LT(star_planner.getTimeSlack(), 0.f);
+}
+
+TEST_F(StarPlannerTests, closedSetAndNodeProximity) {
+  // GIVEN: an open space with obstacles behind the vehicle, so the tree can
+  // grow in all directions towards the goal
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  for (float x = -10.f; x < 10.f; x += 0.5f) {
+    for (float z = 0.f; z < 8.f; z += 0.5f) {
+      cloud.push_back(toXYZI(x, -8.f, z, 0));
+    }
+  }
+  star_planner.setPointcloud(cloud);
+
+  avoidance::LocalPlannerNodeConfig config = avoidance::LocalPlannerNodeConfig::__getDefault__();
+  config.children_per_node_ = 8;
+  config.tree_node_distance_ = 3.0;
+  config.max_sensor_range_ = 40.0;
+
+  for (int n_expanded_nodes : {50, 200}) {
+    // WHEN: we build trees of increasing size
+    config.n_expanded_nodes_ = n_expanded_nodes;
+    star_planner.dynamicReconfigureSetStarParams(config, 1);
+    star_planner.buildLookAheadTree();
+
+    // THEN: all nodes should have been expanded and no two nodes should be closer than 0.2m
+    EXPECT_EQ(n_expanded_nodes, star_planner.closed_set_.size());
+    for (size_t i = 0; i < star_planner.tree_.size(); i++) {
+      for (size_t j = i + 1; j < star_planner.tree_.size(); j++) {
+        EXPECT_GE((star_planner.tree_[i].getPosition() - star_planner.tree_[j].getPosition()).norm(), 0.2f);
+      }
+    }
+  }
+}
+
 TEST_F(StarPlannerTests, heuristicFunction) {}
@@ -0,0 +1,67 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "../include/local_planner/triple_buffer.h"
+
+using namespace avoidance;
+
+TEST(TripleBuffer, handsOverLatestValue) {
+  // GIVEN: an empty buffer
+  TripleBuffer<int> buffer;
+  EXPECT_FALSE(buffer.hasNewData());
+  EXPECT_FALSE(buffer.update());
+
+  // WHEN: two values are published before the consumer looks
+  buffer.write() = 1;
+  buffer.publish();
+  buffer.write() = 2;
+  buffer.publish();
+
+  // THEN: the consumer should only get the latest one, once
+  EXPECT_TRUE(buffer.hasNewData());
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(2, buffer.read());
+  EXPECT_FALSE(buffer.hasNewData());
+  EXPECT_FALSE(buffer.update());
+  EXPECT_EQ(2, buffer.read());
+
+  // AND: the slots should never alias while being used
+  buffer.write() = 3;
+  EXPECT_EQ(2, buffer.read());
+  buffer.publish();
+  EXPECT_TRUE(buffer.update());
+  EXPECT_EQ(3, buffer.read());
+}
+
+TEST(TripleBuffer, concurrentHandoff) {
+  // GIVEN: a producer filling whole vectors with a sequence number
+  TripleBuffer<std::vector<int>> buffer;
+  const int num_frames = 20000;
+  const size_t frame_size = 64;
+  std::thread producer([&]() {
+    for (int frame = 1; frame <= num_frames; frame++) {
+      buffer.write().assign(frame_size, frame);
+      buffer.publish();
+    }
+  });
+
+  // WHEN: the consumer picks up frames while they are written
+  int last_frame = 0;
+  bool torn = false;
+  bool out_of_order = false;
+  while (last_frame < num_frames) {
+    if (!buffer.update()) continue;
+    const std::vector<int>& values = buffer.read();
+    for (int value : values) torn |= value != values.front();
+    out_of_order |= values.front() <= last_frame;
+    last_frame = values.front();
+  }
+  producer.join();
+
+  // THEN: every frame should be complete and the sequence should only increase
+  EXPECT_FALSE(torn);
+  EXPECT_FALSE(out_of_order);
+  EXPECT_EQ(num_frames, last_frame);
+}
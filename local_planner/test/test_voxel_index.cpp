@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "../include/local_planner/voxel_index.h"
+
+using namespace avoidance;
+
+TEST(VoxelIndex, radiusSearchMatchesBruteForce) {
+  // GIVEN: a random cloud and an index over it
+  std::mt19937 generator(7);
+  std::uniform_real_distribution<float> coordinate(-20.f, 20.f);
+  pcl::PointCloud<pcl::PointXYZI> cloud;
+  for (int i = 0; i < 5000; ++i) {
+    pcl::PointXYZI p;
+    p.x = coordinate(generator);
+    p.y = coordinate(generator);
+    p.z = coordinate(generator) / 4.f;
+    p.intensity = static_cast<float>(i);
+    cloud.push_back(p);
+  }
+  cloud.push_back(cloud.points[0]);
+  cloud.points.back().x = NAN;  // invalid points are not indexed
+
+  VoxelIndex index;
+  index.build(cloud, 2.5f);
+  EXPECT_EQ(5000, index.size());
+
+  const std::vector<Eigen::Vector3f> centers = {Eigen::Vector3f(0.f, 0.f, 0.f), Eigen::Vector3f(13.f, -7.f, 2.f),
+                                                Eigen::Vector3f(-25.f, 25.f, 0.f), Eigen::Vector3f(60.f, 0.f, 0.f)};
+  pcl::PointCloud<pcl::PointXYZI> result;
+  for (const Eigen::Vector3f& center : centers) {
+    // WHEN: we query the points within 10m
+    index.radiusSearch(center, 10.f, result);
+
+    // THEN: the result should contain exactly the points a linear scan finds
+    std::vector<int> expected_ids, found_ids;
+    for (const auto& p : cloud.points) {
+      if ((Eigen::Vector3f(p.x, p.y, p.z) - center).norm() <= 10.f) {
+        expected_ids.push_back(static_cast<int>(p.intensity));
+      }
+    }
+    for (const auto& p : result.points) {
+      found_ids.push_back(static_cast<int>(p.intensity));
+    }
+    std::sort(expected_ids.begin(), expected_ids.end());
+    std::sort(found_ids.begin(), found_ids.end());
+    EXPECT_EQ(expected_ids, found_ids);
+    EXPECT_EQ(result.points.size(), result.width);
+  }
+}
@@ -10,6 +10,7 @@
 #include <geometry_msgs/PoseStamped.h>
 #include <mavros_msgs/CompanionProcessStatus.h>
 #include <pcl/filters/filter.h>
+#include <pcl_conversions/pcl_conversions.h>
 #include <pcl_ros/point_cloud.h>
 #include <pcl_ros/transforms.h>
 #include <ros/ros.h>
@@ -18,8 +19,10 @@
 #include <tf/transform_listener.h>
 #include <atomic>
 #include <condition_variable>
+#include <limits>
 #include <mutex>
 #include <thread>
+#include <vector>
 
 #include "safe_landing_planner.hpp"
 #include "safe_landing_planner_visualization.hpp"
@@ -85,6 +88,8 @@ class SafeLandingPlannerNode {
 
   bool position_received_ = false;
   bool cloud_transformed_ = false;
+  std::atomic<float> deskew_scan_time_s_{0.f};
+  std::atomic<int> deskew_slices_{8};
   double spin_dt_ = 0.1;
 
   dynamic_reconfigure::Server<safe_landing_planner::SafeLandingPlannerNodeConfig> server_;
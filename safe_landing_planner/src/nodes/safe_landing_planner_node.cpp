@@ -41,6 +41,8 @@ void SafeLandingPlannerNode::dynamicReconfigureCallback(safe_landing_planner::Sa
                                                         uint32_t level) {
   rqt_param_config_ = config;
   safe_landing_planner_->dynamicReconfigureSetParams(config, level);
+  deskew_scan_time_s_ = static_cast<float>(config.deskew_scan_time);
+  deskew_slices_ = config.deskew_slices;
 }
 
 void SafeLandingPlannerNode::positionCallback(const geometry_msgs::PoseStamped &msg) {
@@ -215,20 +217,53 @@ void SafeLandingPlannerNode::pointCloudTransformThread() {
       if (should_exit_) break;
 
       std::unique_ptr<std::lock_guard<std::mutex>> cloud_msg_lock(new std::lock_guard<std::mutex>(*(cloud_msg_mutex_)));
-      if (tf_listener_.canTransform("/local_origin", newest_cloud_msg_.header.frame_id,
-                                    newest_cloud_msg_.header.stamp)) {
+      // when de-skewing, the rows are spread over the scan time around the stamp and the last ones need the
+      // transforms after it
+      const std_msgs::Header header = newest_cloud_msg_.header;
+      const float scan_time_s = deskew_scan_time_s_;
+      const ros::Duration scan_duration(scan_time_s > 0.f ? scan_time_s : 0.f);
+      if (tf_listener_.canTransform("/local_origin", header.frame_id,
+                                    header.stamp + ros::Duration(0.5 * scan_duration.toSec()))) {
         try {
           pcl::PointCloud<pcl::PointXYZ> pcl_cloud;
-          // transform message to pcl type
-          pcl::fromROSMsg(newest_cloud_msg_, pcl_cloud);
-          cloud_msg_lock.reset();
-          // remove nan padding
-          std::vector<int> dummy_index;
-          dummy_index.reserve(pcl_cloud.points.size());
-          pcl::removeNaNFromPointCloud(pcl_cloud, pcl_cloud, dummy_index);
-
-          // transform cloud to /local_origin frame
-          pcl_ros::transformPointCloud("/local_origin", pcl_cloud, pcl_cloud, tf_listener_);
+          bool deskewed = false;
+          if (scan_time_s > 0.f) {
+            // remove nan padding and transform every slice of rows to /local_origin frame at its capture time
+            auto lookup = [&](const ros::Time &time, tf::StampedTransform &transform) {
+              try {
+                tf_listener_.lookupTransform("/local_origin", header.frame_id, time, transform);
+              } catch (tf::TransformException &) {
+                return false;
+              }
+              return true;
+            };
+            std::vector<tf::StampedTransform> slice_transforms;
+            pcl::PointCloud<pcl::PointXYZ> maxima;
+            const size_t num_slices = static_cast<size_t>(std::max(1, deskew_slices_.load()));
+            if (!getSliceTransforms(header.stamp, scan_duration, num_slices, lookup, slice_transforms)) {
+              ROS_WARN_THROTTLE(5.0, "Missing transforms of the pointcloud slices, it is not de-skewed");
+            } else if (!transformPointCloud2AndGetMaxima(newest_cloud_msg_, slice_transforms,
+                                                         std::numeric_limits<float>::infinity(), pcl_cloud, maxima)) {
+              ROS_WARN_THROTTLE(5.0, "Pointcloud has no FLOAT32 x, y, z fields, it cannot be de-skewed");
+            } else {
+              cloud_msg_lock.reset();
+              pcl_cloud.header.frame_id = "/local_origin";
+              pcl_cloud.header.stamp = pcl_conversions::toPCL(header.stamp);
+              deskewed = true;
+            }
+          }
+          if (!deskewed) {
+            // transform message to pcl type
+            pcl::fromROSMsg(newest_cloud_msg_, pcl_cloud);
+            cloud_msg_lock.reset();
+            // remove nan padding
+            std::vector<int> dummy_index;
+            dummy_index.reserve(pcl_cloud.points.size());
+            pcl::removeNaNFromPointCloud(pcl_cloud, pcl_cloud, dummy_index);
+
+            // transform cloud to /local_origin frame
+            pcl_ros::transformPointCloud("/local_origin", pcl_cloud, pcl_cloud, tf_listener_);
+          }
 
           std::lock_guard<std::mutex> transformed_cloud_guard(*(transformed_cloud_mutex_));
           cloud_transformed_ = true;